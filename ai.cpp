@@ -1,9 +1,16 @@
 #include "ai.hpp"
+#include "game_end.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
 
 namespace {
 
 constexpr int MIN = std::numeric_limits<int>::min() + 1;
 constexpr int MAX = std::numeric_limits<int>::max() - 1;
+// Typical number of moves in position
+constexpr size_t MOVES_RESERVE = 64u;
 
 } // namespace
 
@@ -11,21 +18,118 @@ AI::AI(Board& b, Color c, const BoardStats& stats)
     : _board(b)
     , _color(c)
     , _boardStats(stats)
+    , _tablebases(tablebase::defaultTablebases())
+    , _trace(defaultTrace())
 {
 }
 
 void AI::run()
 {
+    auto task = search(0u);
+    while (!task.resume()) {
+    }
+}
+
+SearchTask AI::search(size_t sliceNodes)
+{
+    _depth = 0u;
+    _nodes = 0u;
+    bindThread();
+    _board.reserveUndoMoves(UNDO_MOVES_RESERVE);
+    _pvTable.resize(MAX_PLY * MAX_PLY);
+    _previousPv.clear();
+    _previousPv.reserve(MAX_PLY);
+    // Everything iterations need is sized here, search does not allocate once it started
+    for (auto* lines : { &_lines, &_iterationLines }) {
+        lines->resize(std::max(lines->size(), _multiPv));
+        for (auto& line : *lines) {
+            line.pv.reserve(MAX_PLY);
+        }
+    }
+    RootSearch root;
+    root.moves.reserve(ROOT_MOVES_RESERVE);
+    std::vector<Move> excluded;
+    excluded.reserve(_multiPv);
+    auto sliceEnd = sliceNodes;
+
     // Depth is increased by two = one ply
-    for (size_t depth = MIN_DEPTH; depth <= MAX_DEPTH; depth += 2u) {
-        const auto move = countBestMove(_board, _color, depth);
-        if (!move) {
+    for (size_t depth = std::min(MIN_DEPTH, _maxDepth); depth <= _maxDepth; depth += 2u) {
+        _stats.beginIteration();
+        _numIterationLines = 0u;
+        excluded.clear();
+
+        // Every pass finds best root move not found by previous ones,
+        // passes share transposition table so later ones are cheap
+        while (_numIterationLines < _multiPv) {
+            beginRoot(_board, _color, root, depth, excluded);
+            while (searchRootMove(_board, _color, root, excluded)) {
+                if (sliceNodes > 0u && _nodes >= sliceEnd) {
+                    // Board is back at root, other searches may run on this thread meanwhile
+                    _stats.suspend();
+                    co_await std::suspend_always {};
+                    bindThread();
+                    _stats.resume();
+                    sliceEnd = _nodes + sliceNodes;
+                }
+            }
+            auto& line = _iterationLines[_numIterationLines];
+            if (!endRoot(root, excluded, line) || (_stop && _numIterationLines > 0u)) {
+                break;
+            }
+            excluded.push_back(line.move);
+            _numIterationLines++;
+            if (_stop) {
+                break;
+            }
+        }
+
+        const auto completed = _numIterationLines > 0u;
+        _stats.endIteration(depth, completed && !_stop);
+        if (!completed) {
             continue;
         }
+        const auto move = std::make_pair(_iterationLines.front().move, _iterationLines.front().score);
         if (_stop) {
-            return;
+            // Partially searched first iteration is better than no move under tight deadline
+            if (!_bestMove) {
+                _bestMove = move;
+                _lines.swap(_iterationLines);
+                _numLines = _numIterationLines;
+            }
+            co_return;
         }
         _bestMove = move;
+        _depth = depth;
+        _lines.swap(_iterationLines);
+        _numLines = _numIterationLines;
+        _previousPv = _lines.front().pv;
+        printLines(depth);
+        if (_infoCallback) {
+            _infoCallback(depth, lines());
+        }
+    }
+}
+
+void AI::bindThread()
+{
+    _evaluator = &Evaluator::threadLocal();
+    _tt = _table ? _table : &TranspositionTable::threadLocal();
+    _history = &SearchHistory::threadLocal();
+    _arena = &Arena::threadLocal();
+    _traceBuffer = _trace ? &_trace->buffer() : nullptr;
+}
+
+void AI::printLines(size_t depth) const
+{
+    if (!_infoOutput) {
+        return;
+    }
+    for (size_t i = 0u; i < _numLines; i++) {
+        *_infoOutput << "depth " << depth << " multipv " << (i + 1u) << " score " << _lines[i].score << " nodes " << _nodes << " pv";
+        for (const auto& m : _lines[i].pv) {
+            *_infoOutput << ' ' << m;
+        }
+        *_infoOutput << std::endl;
     }
 }
 
@@ -42,84 +146,459 @@ std::optional<Move> AI::bestMove() const
     return _bestMove->first;
 }
 
-std::optional<AI::MoveAndScore> AI::countBestMove(Board& b, Color c, size_t depth) const
+std::optional<int> AI::bestScore() const
 {
-    auto generator = b.moveGenerator(c);
-    if (!generator.hasMoves()) {
-        return {};
+    if (!_bestMove) {
+        return std::nullopt;
     }
-    const bool kingCheck = kingInCheck(b, c);
-    int bestScore = MIN;
-    Move bestMove;
+    return _bestMove->second;
+}
 
-    while (generator.hasMoves()) {
-        for (const auto& m : generator.movesChunk()) {
-            // You cannot do castling if king is in check
-            if (m.type == MoveType::CASTLING && kingCheck) {
-                continue;
-            }
-            int undos = b.applyMove(m);
-            if (_boardStats.threeFoldRepetition(b)) {
-                // skip this move
-                b.undoMove(undos);
-                continue;
-            }
-            const auto score = -negascout(b, enemyColor(c), MIN, MAX, depth - 1u, _stop);
-            if (score > bestScore) {
-                bestScore = score;
-                bestMove = m;
-            }
+void AI::beginRoot(Board& b, Color c, RootSearch& root, size_t depth, const std::vector<Move>& excluded)
+{
+    root.depth = depth;
+    root.next = 0u;
+    root.kingCheck = b.kingInCheck(c);
+    root.key = TranspositionTable::key(b, c);
+    // Only first pass follows previous best line
+    root.followPv = excluded.empty() && !_previousPv.empty();
+    root.pvMove = root.followPv ? TranspositionTable::packMove(_previousPv.front()) : 0u;
+    root.alpha = MIN;
+    root.bestMove.reset();
+    _maxExtension = depth * ONE_PLY / 2u;
+    const auto* entry = _tt->probe(root.key);
+    const Arena::Scope scope(*_arena);
+    const auto moves = orderedMoves(b, c, false, entry ? entry->move : 0u, root.pvMove);
+    root.moves.assign(moves.begin(), moves.end());
+    _pvLength[0] = 0u;
+}
+
+bool AI::searchRootMove(Board& b, Color c, RootSearch& root, const std::vector<Move>& excluded)
+{
+    while (root.next < root.moves.size()) {
+        const auto& m = root.moves[root.next++].first;
+        if (!castlingAllowed(b, c, m, root.kingCheck)) {
+            continue;
+        }
+        if (std::find(excluded.begin(), excluded.end(), m) != excluded.end()) {
+            continue;
+        }
+        auto& alpha = root.alpha;
+
+        const auto capture = b.isCapture(m);
+        const auto moved = b.get(m.from.x, m.from.y);
+        _moveStack[0] = TranspositionTable::packMove(m);
+        _pieceToStack[0] = SearchHistory::pieceTo(moved, m.to);
+        _captureStack[0] = capture ? static_cast<uint8_t>(m.to.y * Board::WIDTH + m.to.x + 1) : 0u;
+        const auto checkTest = mayExposeKing(b, c, m, root.kingCheck);
+        const auto undos = b.applyMove(m);
+        if (checkTest && b.kingInCheck(c)) {
             b.undoMove(undos);
+            continue;
+        }
+        const auto ext = std::min(extension(c, m, moved, capture, b.kingInCheck(enemyColor(c)), 0u), _maxExtension);
+        _pathExtension[1] = ext;
+        const auto depth = root.depth * ONE_PLY - ONE_PLY + ext;
+        int score;
+        if (_boardStats.threeFoldRepetition(b)) {
+            // Repetition is a draw, it may be the only legal move
+            score = 0;
+            _pvLength[1] = 1u;
+        } else if (!root.bestMove) {
+            _followPv = root.followPv && TranspositionTable::packMove(m) == root.pvMove;
+            score = -searchRootChild(b, enemyColor(c), MIN, MAX, depth);
+            _followPv = false;
+        } else {
+            score = -searchRootChild(b, enemyColor(c), -alpha - 1, -alpha, depth);
+            if (score > alpha) {
+                SEARCH_STAT_INC(researches);
+                score = -searchRootChild(b, enemyColor(c), MIN, -alpha, depth);
+            }
+        }
+        b.undoMove(undos);
+        if (!root.bestMove || score > alpha) {
+            alpha = score;
+            root.bestMove = m;
+            updatePv(0u, m);
         }
+        return true;
     }
+    return false;
+}
 
-    return std::make_optional(std::make_pair(bestMove, bestScore));
+bool AI::endRoot(const RootSearch& root, const std::vector<Move>& excluded, PvLine& line)
+{
+    if (!root.bestMove) {
+        return false;
+    }
+    // Later passes exclude best move, their result does not belong to this position
+    if (excluded.empty() && !_stop) {
+        _tt->store(root.key, scoreToTt(root.alpha, 0u), TranspositionTable::packMove(*root.bestMove), root.depth * ONE_PLY, TranspositionTable::Bound::EXACT);
+    }
+    line.move = *root.bestMove;
+    line.score = root.alpha;
+    line.pv.assign(_pvTable.begin(), _pvTable.begin() + _pvLength[0]);
+    return true;
 }
 
-bool AI::kingInCheck(const Board& b, Color c) const
+void AI::updatePv(size_t ply, const Move& m)
 {
-    const auto kingPosition = b.kingPosition(c);
+    if (ply + 1u >= MAX_PLY) {
+        return;
+    }
+    auto* row = &_pvTable[ply * MAX_PLY];
+    const auto* childRow = &_pvTable[(ply + 1u) * MAX_PLY];
+    const auto childLength = std::max(_pvLength[ply + 1u], ply + 1u);
 
-    for (auto generator = b.moveGenerator(enemyColor(c)); generator.hasMoves();) {
-        for (const auto& m : generator.movesChunk()) {
-            if (m.to == kingPosition) {
-                return true;
-            }
-        }
+    row[ply] = m;
+    std::copy(childRow + ply + 1u, childRow + childLength, row + ply + 1u);
+    _pvLength[ply] = childLength;
+}
+
+void AI::checkDeadline()
+{
+    if (_deadline && _nodes % DEADLINE_CHECK_NODES == 0u && Clock::now() >= *_deadline) {
+        _stop = true;
     }
+}
 
-    return false;
+int AI::searchRootChild(Board& b, Color c, int alpha, int beta, size_t depth)
+{
+    return _traceBuffer ? negascout<true>(b, c, alpha, beta, depth, 1u) : negascout<false>(b, c, alpha, beta, depth, 1u);
+}
+
+size_t AI::extension(Color c, const Move& m, Square moved, bool capture, bool givesCheck, size_t ply) const
+{
+    if (givesCheck) {
+        return CHECK_EXTENSION;
+    }
+    // Capture on square where opponent has just captured
+    if (capture && ply > 0u && _captureStack[ply - 1u] == m.to.y * Board::WIDTH + m.to.x + 1) {
+        return RECAPTURE_EXTENSION;
+    }
+    const auto f = figure(moved);
+    if ((f == Figure::PAWN || f == Figure::PAWN_IDLE || f == Figure::PAWN_EN_PASSANT) && m.to.y == (c == Color::WHITE ? Board::HEIGHT - 2 : 1)) {
+        return PAWN_EXTENSION;
+    }
+    return 0u;
 }
 
-int AI::negascout(Board& b, Color c, int alpha, int beta, size_t depth, const std::atomic_bool& stop)
+template <bool TRACE>
+int AI::negascout(Board& b, Color c, int alpha, int beta, size_t depth, size_t ply)
 {
-    if (depth == 0 || b.kingCaptured() || (stop && depth % 2u == 0u)) {
-        // Bottom of search tree
-        // King is dead
-        // Negascout is stopped and ply finished
-        return b.score() * (depth % 2 ? -1 : 1);
+    // Line of this node is empty until some move gets exact score
+    _pvLength[std::min(ply, MAX_PLY)] = ply;
+    if (depth < ONE_PLY) {
+        // Bottom of search tree, resolve captures
+        return quiescence(b, c, alpha, beta);
+    }
+    [[maybe_unused]] const auto entryNodes = _nodes;
+    [[maybe_unused]] TraceRecord record;
+    if constexpr (TRACE) {
+        record.alpha = alpha;
+        record.beta = beta;
+        record.move = _moveStack[ply - 1u];
+        record.ply = static_cast<uint8_t>(ply);
+        record.depth = static_cast<uint8_t>(depth / ONE_PLY);
+    }
+    // Writes record of returning node
+    const auto leave = [&](TraceNode type, int score) {
+        if constexpr (TRACE) {
+            record.subtree = static_cast<uint32_t>(std::min<size_t>(_nodes - entryNodes, UINT32_MAX));
+            record.score = score;
+            record.type = type;
+            _traceBuffer->record(record);
+        }
+        return score;
+    };
+    _nodes++;
+    SEARCH_STAT_INC(nodes);
+    checkDeadline();
+
+    if ((_stop && ply % 2u == 0u) || ply >= MAX_PLY) {
+        // Negascout is stopped and root side is to move, its result is discarded unless iteration has no move yet
+        // Path is too long for move stacks
+        SEARCH_STAT_INC(leafNodes);
+        return leave(TraceNode::LEAF, _evaluator->evaluate(b, c));
+    }
+    if (insufficientMaterial(b)) {
+        return leave(TraceNode::TERMINAL, 0);
+    }
+    if (_tablebases && b.figureCount() <= static_cast<int>(tablebase::MAX_FIGURES)) {
+        // Exact endgame result, no need to search deeper
+        // Its distance is counted from this node, like stored mate scores it is moved to distance from root
+        if (const auto score = _tablebases->score(b, c)) {
+            SEARCH_STAT_INC(tablebaseHits);
+            return leave(TraceNode::TABLEBASE, scoreFromTt(*score, ply));
+        }
     }
+    const auto key = TranspositionTable::key(b, c);
+    uint16_t hashMove = 0u;
+    if (const auto* entry = _tt->probe(key)) {
+        SEARCH_STAT_INC(ttHits);
+        hashMove = entry->move;
+        // Nodes with open window are always searched, their PV would be lost
+        const auto ttScore = scoreFromTt(entry->score, ply);
+        if (entry->depth >= depth && beta - alpha == 1
+            && (entry->bound == TranspositionTable::Bound::EXACT
+                || (entry->bound == TranspositionTable::Bound::LOWER && ttScore >= beta)
+                || (entry->bound == TranspositionTable::Bound::UPPER && ttScore <= alpha))) {
+            SEARCH_STAT_INC(ttCutoffs);
+            return leave(TraceNode::TT_CUTOFF, ttScore);
+        }
+    }
+    const auto inCheck = b.kingInCheck(c);
+    // Frontier pruning of null window nodes by static score, in check every move has to be searched
+    bool futilityPruning = false;
+    const auto plies = depth / ONE_PLY;
+    if (beta - alpha == 1 && plies <= PruningMargins::FRONTIER_DEPTH && std::abs(beta) < PRUNING_SCORE_LIMIT && !inCheck) {
+        const auto staticScore = _evaluator->evaluate(b, c);
+        const auto reverseMargin = _margins.reverseFutility[plies];
+        if (reverseMargin > 0 && staticScore - reverseMargin >= beta) {
+            SEARCH_STAT_INC(reverseFutilityCutoffs);
+            return leave(TraceNode::REVERSE_FUTILITY, staticScore - reverseMargin);
+        }
+        const auto razorMargin = _margins.razoring[plies];
+        if (razorMargin > 0 && staticScore + razorMargin <= alpha) {
+            const auto score = quiescence(b, c, alpha, beta);
+            if (score <= alpha) {
+                SEARCH_STAT_INC(razorCutoffs);
+                return leave(TraceNode::RAZOR, score);
+            }
+        }
+        const auto futilityMargin = _margins.futility[plies];
+        futilityPruning = futilityMargin > 0 && staticScore + futilityMargin <= alpha;
+    }
+
+    // Node lies on previous iteration's best line, its next move is searched first
+    const bool followPv = _followPv && ply < _previousPv.size();
+    const auto pvMove = followPv ? TranspositionTable::packMove(_previousPv[ply]) : 0u;
+    _followPv = false;
+
+    const auto originalAlpha = alpha;
+    uint16_t bestMove = 0u;
     int score = MIN;
     bool first = true;
+    size_t moveIndex = 0u;
+    std::array<uint16_t, MAX_QUIETS> quiets, quietPieceTo;
+    size_t numQuiets = 0u;
 
-    for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
-        for (const auto& m : generator.movesChunk()) {
-            int undos = b.applyMove(m);
-            if (first) {
-                score = -negascout(b, enemyColor(c), -beta, -alpha, depth - 1, stop);
-                first = false;
-            } else {
-                score = -negascout(b, enemyColor(c), -alpha - 1, -alpha, depth - 1, stop);
-                if (alpha < score && score < beta) {
-                    score = -negascout(b, enemyColor(c), -beta, -score, depth - 1, stop);
+    const Arena::Scope scope(*_arena);
+    for (const auto& [m, moveScore] : orderedMoves(b, c, false, hashMove, pvMove, ply)) {
+        if (!castlingAllowed(b, c, m, inCheck)) {
+            continue;
+        }
+        const bool quiet = isQuiet(b, m);
+        const auto capture = b.isCapture(m);
+        const auto moved = b.get(m.from.x, m.from.y);
+        const auto packed = TranspositionTable::packMove(m);
+        const auto pieceTo = SearchHistory::pieceTo(moved, m.to);
+        const auto checkTest = mayExposeKing(b, c, m, inCheck);
+        int undos = b.applyMove(m);
+        if (checkTest && b.kingInCheck(c)) {
+            // Illegal, own king would be captured
+            b.undoMove(undos);
+            continue;
+        }
+        const auto givesCheck = b.kingInCheck(enemyColor(c));
+        const auto ext = std::min(extension(c, m, moved, capture, givesCheck, ply), _maxExtension - _pathExtension[ply]);
+        if (futilityPruning && !first && quiet && !givesCheck) {
+            // Quiet move cannot lift hopeless static score above alpha
+            SEARCH_STAT_INC(futilityPruned);
+            b.undoMove(undos);
+            continue;
+        }
+        _moveStack[ply] = packed;
+        _pieceToStack[ply] = pieceTo;
+        _captureStack[ply] = capture ? static_cast<uint8_t>(m.to.y * Board::WIDTH + m.to.x + 1) : 0u;
+        _pathExtension[ply + 1u] = _pathExtension[ply] + ext;
+        const auto childDepth = depth - ONE_PLY + ext;
+        if (first) {
+            _followPv = followPv && TranspositionTable::packMove(m) == pvMove;
+            score = -negascout<TRACE>(b, enemyColor(c), -beta, -alpha, childDepth, ply + 1u);
+            _followPv = false;
+            first = false;
+        } else {
+            score = -negascout<TRACE>(b, enemyColor(c), -alpha - 1, -alpha, childDepth, ply + 1u);
+            if (alpha < score && score < beta) {
+                SEARCH_STAT_INC(researches);
+                score = -negascout<TRACE>(b, enemyColor(c), -beta, -alpha, childDepth, ply + 1u);
+            }
+        }
+        b.undoMove(undos);
+        if (score > alpha) {
+            alpha = score;
+            bestMove = packed;
+            if (score < beta) {
+                updatePv(ply, m);
+            }
+        }
+        if (alpha >= beta) {
+            SEARCH_STAT_INC(betaCutoffs);
+            if (moveIndex == 0u) {
+                SEARCH_STAT_INC(firstMoveBetaCutoffs);
+            }
+            if (!_stop) {
+                _tt->store(key, scoreToTt(alpha, ply), bestMove, depth, TranspositionTable::Bound::LOWER);
+                if (quiet) {
+                    updateHistory(c, ply, plies, packed, pieceTo, quiets.data(), quietPieceTo.data(), numQuiets);
                 }
             }
-            b.undoMove(undos);
-            alpha = std::max(alpha, score);
-            if (alpha >= beta) {
-                return alpha;
+            if constexpr (TRACE) {
+                record.moves = static_cast<uint16_t>(moveIndex + 1u);
+                record.cutoffIndex = static_cast<uint8_t>(std::min<size_t>(moveIndex, TraceRecord::NO_CUTOFF - 1u));
             }
+            return leave(TraceNode::CUT, alpha);
+        }
+        if (quiet && numQuiets < MAX_QUIETS) {
+            quiets[numQuiets] = packed;
+            quietPieceTo[numQuiets++] = pieceTo;
+        }
+        moveIndex++;
+    }
+    if (first) {
+        // No legal move, shorter mate is worse for mated side
+        return leave(TraceNode::TERMINAL, inCheck ? -(MATE_SCORE - static_cast<int>(ply)) : 0);
+    }
+    // Scores of stopped search are not exact
+    if (!_stop) {
+        _tt->store(key, scoreToTt(alpha, ply), bestMove, depth, alpha > originalAlpha ? TranspositionTable::Bound::EXACT : TranspositionTable::Bound::UPPER);
+    }
+    if constexpr (TRACE) {
+        record.moves = static_cast<uint16_t>(moveIndex);
+    }
+    return leave(alpha > originalAlpha ? TraceNode::PV : TraceNode::ALL, alpha);
+}
+
+int AI::quiescence(Board& b, Color c, int alpha, int beta)
+{
+    _nodes++;
+    SEARCH_STAT_INC(qNodes);
+    checkDeadline();
+
+    // Side to move is not forced to capture, static score is a lower bound
+    const auto standPat = _evaluator->evaluate(b, c);
+    if (standPat >= beta) {
+        return standPat;
+    }
+    alpha = std::max(alpha, standPat);
+    const auto inCheck = b.kingInCheck(c);
+
+    const Arena::Scope scope(*_arena);
+    for (const auto& [m, moveScore] : orderedMoves(b, c, true)) {
+        if (moveScore < GOOD_CAPTURE) {
+            // Losing captures are pruned
+            SEARCH_STAT_INC(seePrunedCaptures);
+            continue;
+        }
+        const auto checkTest = mayExposeKing(b, c, m, inCheck);
+        const auto undos = b.applyMove(m);
+        if (checkTest && b.kingInCheck(c)) {
+            // Illegal, own king would be captured
+            b.undoMove(undos);
+            continue;
+        }
+        const auto score = -quiescence(b, enemyColor(c), -beta, -alpha);
+        b.undoMove(undos);
+        alpha = std::max(alpha, score);
+        if (alpha >= beta) {
+            return alpha;
         }
     }
     return alpha;
+}
+
+void AI::updateHistory(Color c, size_t ply, size_t depth, uint16_t move, uint16_t pieceTo, const uint16_t* quiets, const uint16_t* quietPieceTo, size_t numQuiets)
+{
+    const auto bonus = std::min(HISTORY_BONUS * static_cast<int>(depth * depth), MAX_HISTORY_BONUS);
+    const auto update = [&](uint16_t m, uint16_t to, int value) {
+        SearchHistory::update(_history->butterfly(c, m), value);
+        for (size_t plies = 1u; plies <= SearchHistory::CONTINUATION_PLIES && plies <= ply; plies++) {
+            SearchHistory::update(_history->continuation(plies, _pieceToStack[ply - plies])[to], value);
+        }
+    };
+
+    update(move, pieceTo, bonus);
+    for (size_t i = 0u; i < numQuiets; i++) {
+        update(quiets[i], quietPieceTo[i], -bonus);
+    }
+    if (ply > 0u) {
+        _history->counterMove(_moveStack[ply - 1u]) = move;
+    }
+}
+
+bool AI::isQuiet(const Board& b, const Move& m)
+{
+    if (b.isCapture(m)) {
+        return false;
+    }
+    // Promotion changes figure
+    const auto f = figure(b.get(m.from.x, m.from.y));
+    return !((f == Figure::PAWN || f == Figure::PAWN_EN_PASSANT) && figure(m.toSq) == Figure::QUEEN);
+}
+
+AI::ScoredMoves AI::orderedMoves(const Board& b, Color c, bool capturesOnly, uint16_t hashMove, uint16_t pvMove, size_t ply) const
+{
+    ScoredMoves moves(*_arena);
+    moves.reserve(MOVES_RESERVE);
+
+    // Quiet move context, moves one and two plies back
+    uint16_t counterMove = 0u;
+    const int16_t* continuations[SearchHistory::CONTINUATION_PLIES] = {};
+    if (!capturesOnly) {
+        counterMove = ply > 0u ? _history->counterMove(_moveStack[ply - 1u]) : 0u;
+        for (size_t plies = 1u; plies <= SearchHistory::CONTINUATION_PLIES && plies <= ply; plies++) {
+            continuations[plies - 1u] = _history->continuation(plies, _pieceToStack[ply - plies]);
+        }
+    }
+
+    // Allocated after scored list, so its space is given back right on return
+    MoveList generated(*_arena);
+    generated.reserve(MOVES_RESERVE);
+    for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
+        generator.movesChunk(generated);
+    }
+
+    for (const auto& m : generated) {
+        if (pvMove != 0u || hashMove != 0u) {
+            const auto packed = TranspositionTable::packMove(m);
+            if (packed == pvMove || packed == hashMove) {
+                moves.emplace_back(m, packed == pvMove ? PV_MOVE : HASH_MOVE);
+                continue;
+            }
+        }
+        if (!b.isCapture(m)) {
+            if (capturesOnly) {
+                continue;
+            }
+            const auto packed = TranspositionTable::packMove(m);
+            if (packed == counterMove) {
+                moves.emplace_back(m, COUNTER_MOVE);
+                continue;
+            }
+            const auto pieceTo = SearchHistory::pieceTo(b.get(m.from.x, m.from.y), m.to);
+            int score = _history->butterfly(c, packed);
+            for (const auto* continuation : continuations) {
+                score += continuation ? continuation[pieceTo] : 0;
+            }
+            moves.emplace_back(m, score);
+            continue;
+        }
+        // Capturing figure worth at least as much as capturing one cannot lose material,
+        // its gain is a lower bound of SEE and full exchange is not resolved
+        const auto victim = m.type == MoveType::EN_PASSANT ? Figure::PAWN : figure(b.get(m.to.x, m.to.y));
+        const auto gain = figureValue(victim) - figureValue(figure(b.get(m.from.x, m.from.y)));
+        const auto see = gain >= 0 ? gain : b.see(m);
+        moves.emplace_back(m, see >= 0 ? GOOD_CAPTURE + see : see - GOOD_CAPTURE);
+    }
+
+    // PV and hash move, winning and even captures, counter move, quiet moves by history, losing captures last
+    // Stable insertion sort, std::stable_sort would take its buffer from global allocator
+    for (auto it = moves.begin(); it != moves.end(); ++it) {
+        const auto position = std::upper_bound(moves.begin(), it, *it, [](const auto& m1, const auto& m2) {
+            return m1.second > m2.second;
+        });
+        std::rotate(position, it, it + 1);
+    }
+    return moves;
 }
\ No newline at end of file
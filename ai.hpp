@@ -1,37 +1,272 @@
 #pragma once
 
+#include "arena.hpp"
 #include "board.hpp"
 #include "board_stats.hpp"
+#include "evaluation.hpp"
+#include "history.hpp"
+#include "search_stats.hpp"
+#include "search_task.hpp"
+#include "search_trace.hpp"
+#include "tablebase.hpp"
+#include "tt.hpp"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <optional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+// Root move with its score and principal variation (starting with the move)
+struct PvLine {
+    Move move;
+    int score = 0;
+    std::vector<Move> pv;
+};
+
+// Frontier pruning margins indexed by remaining depth (1 to 3), zero disables pruning at that depth
+struct PruningMargins {
+    static constexpr size_t FRONTIER_DEPTH = 3u;
+
+    // Node fails high if static score minus margin is at least beta
+    std::array<int, FRONTIER_DEPTH + 1u> reverseFutility = { 0, 150, 300, 450 };
+    // Quiet moves are skipped if static score plus margin is at most alpha
+    std::array<int, FRONTIER_DEPTH + 1u> futility = { 0, 200, 350, 500 };
+    // Node drops into quiescence if static score plus margin is at most alpha
+    std::array<int, FRONTIER_DEPTH + 1u> razoring = { 0, 300, 550, 800 };
+};
 
 class AI {
 public:
+    using Clock = std::chrono::steady_clock;
+    // Called on search thread after every finished iteration with its depth and lines
+    using InfoCallback = std::function<void(size_t, std::span<const PvLine>)>;
+
     AI(Board& b, Color c, const BoardStats& stats);
 
+    // Blocking search
     void run();
+    // Same search as coroutine, it suspends between root moves once sliceNodes nodes were visited since last
+    // resume, zero never suspends. Thread local tables of thread resuming it are used
+    SearchTask search(size_t sliceNodes);
     void stop();
 
+    // Limit iterative deepening, used for fixed depth searches (bench)
+    void setMaxDepth(size_t depth)
+    {
+        _maxDepth = depth;
+    }
+
+    // AI stops itself once deadline passes, no timer thread is needed
+    void setDeadline(Clock::time_point deadline)
+    {
+        _deadline = deadline;
+    }
+
+    // Number of best root moves searched with exact score, analysis only
+    void setMultiPv(size_t lines)
+    {
+        _multiPv = std::max<size_t>(lines, 1u);
+    }
+
+    void setPruningMargins(const PruningMargins& margins)
+    {
+        _margins = margins;
+    }
+
+    // Table used instead of thread local one, must not be shared with concurrent search
+    void setTranspositionTable(TranspositionTable* table)
+    {
+        _table = table;
+    }
+
+    // Lines of every finished iteration are written as "depth D multipv K score S nodes N pv ..."
+    void setInfoOutput(std::ostream* os)
+    {
+        _infoOutput = os;
+    }
+
+    void setInfoCallback(InfoCallback callback)
+    {
+        _infoCallback = std::move(callback);
+    }
+
+    // Tablebases probed by search instead of default ones, nullptr disables probing
+    void setTablebases(const tablebase::Tablebases* tablebases)
+    {
+        _tablebases = tablebases;
+    }
+
+    // Trace receiving record of every negascout node instead of default one, nullptr disables tracing
+    void setTrace(SearchTrace* trace)
+    {
+        _trace = trace;
+    }
+
+    // Per iteration statistics, collected only when compiled with MCE_SEARCH_STATS
+    void setStatsOutput(std::ostream* os)
+    {
+        _stats.setOutput(os);
+    }
+
+    const std::vector<IterationStats>& iterationStats() const
+    {
+        return _stats.iterations();
+    }
+
+    // Lines of deepest finished iteration, best first
+    std::span<const PvLine> lines() const
+    {
+        return { _lines.data(), _numLines };
+    }
+
     std::optional<Move> bestMove() const;
+    // Score of best move from AI's point of view
+    std::optional<int> bestScore() const;
+
+    // Deepest fully searched depth of last run
+    size_t depth() const
+    {
+        return _depth;
+    }
+
+    // Number of negascout nodes visited during last run
+    size_t nodes() const
+    {
+        return _nodes;
+    }
 
 private:
     using MoveAndScore = std::pair<Move, int>;
+    // Move lists of negascout nodes live in arena of search thread
+    using ScoredMoves = ArenaVector<MoveAndScore>;
+
+    // Root search pass in progress, root moves are searched one by one
+    struct RootSearch {
+        size_t depth = 0u;
+        // Kept between slices while other searches use the arena, so it is on heap, passes reuse its capacity
+        std::vector<MoveAndScore> moves;
+        size_t next = 0u;
+        bool kingCheck = false;
+        uint64_t key = 0u;
+        bool followPv = false;
+        uint16_t pvMove = 0u;
+        int alpha = 0;
+        std::optional<Move> bestMove;
+    };
 
     // Negascout min, max depth
     static constexpr size_t MIN_DEPTH = 4u;
     static constexpr size_t MAX_DEPTH = 10u;
+    // Ordering score of captures which do not lose material
+    static constexpr int GOOD_CAPTURE = 1000000;
+    // Ordering scores of previous iteration's PV move and transposition table move, searched first
+    static constexpr int PV_MOVE = 3 * GOOD_CAPTURE;
+    static constexpr int HASH_MOVE = 2 * GOOD_CAPTURE;
+    // Counter move goes right after good captures, quiet moves are ordered by history
+    static constexpr int COUNTER_MOVE = GOOD_CAPTURE / 2;
+    // History bonus is HISTORY_BONUS * depth^2, at most MAX_HISTORY_BONUS
+    static constexpr int HISTORY_BONUS = 32;
+    static constexpr int MAX_HISTORY_BONUS = 1600;
+    // Quiet moves searched before cutoff which get malus
+    static constexpr size_t MAX_QUIETS = 64u;
+    // Frontier pruning is off near king capture and tablebase scores
+    static constexpr int PRUNING_SCORE_LIMIT = 50000;
+    // Longest principal variation
+    static constexpr size_t MAX_PLY = 64u;
+    // Negascout depth is counted in quarter plies, so extensions can be fractional
+    static constexpr size_t ONE_PLY = 4u;
+    // Forcing moves are searched deeper, only the largest applicable extension is used
+    static constexpr size_t CHECK_EXTENSION = 4u;
+    static constexpr size_t RECAPTURE_EXTENSION = 2u;
+    static constexpr size_t PAWN_EXTENSION = 2u;
+    // Captures of quiescence line past MAX_PLY, every one removes one of 30 figures besides kings
+    static constexpr size_t MAX_CAPTURES = 30u;
+    // Undo moves of the deepest path, a move takes at most three (en passant expiry, the move itself,
+    // castling rook or pawn captured en passant)
+    static constexpr size_t UNDO_MOVES_RESERVE = 3u * (MAX_PLY + MAX_CAPTURES);
+    // Pseudo legal moves of root position, there are at most 218 legal ones
+    static constexpr size_t ROOT_MOVES_RESERVE = 256u;
+    // Clock is read only once per this many nodes
+    static constexpr size_t DEADLINE_CHECK_NODES = 1024u;
 
     Board& _board;
     const Color _color;
     const BoardStats& _boardStats;
     std::optional<MoveAndScore> _bestMove;
+    size_t _maxDepth = MAX_DEPTH;
+    std::optional<Clock::time_point> _deadline;
+    // Evaluator of search thread, set when search starts or resumes
+    Evaluator* _evaluator = nullptr;
+    const tablebase::Tablebases* _tablebases;
+    SearchTrace* _trace;
+    // Buffer of search thread, set when search starts or resumes
+    SearchTrace::Buffer* _traceBuffer = nullptr;
+    TranspositionTable* _table = nullptr;
+    // Table of search thread, set when search starts or resumes
+    TranspositionTable* _tt = nullptr;
+    size_t _multiPv = 1u;
+    PruningMargins _margins;
+    // Lines keep capacity of their PVs between iterations, only first _numLines (_numIterationLines) are valid
+    std::vector<PvLine> _lines;
+    size_t _numLines = 0u;
+    std::vector<PvLine> _iterationLines;
+    size_t _numIterationLines = 0u;
+    std::ostream* _infoOutput = nullptr;
+    InfoCallback _infoCallback;
+    // Triangular PV table, row ply (MAX_PLY moves) holds best line from ply, filled on exact score nodes
+    std::vector<Move> _pvTable;
+    std::array<size_t, MAX_PLY + 1u> _pvLength {};
+    // Best line of previous iteration, its moves are searched first while search follows it
+    std::vector<Move> _previousPv;
+    bool _followPv = false;
+    // Quiet move statistics of search thread, set when search starts or resumes
+    SearchHistory* _history = nullptr;
+    Arena* _arena = nullptr;
+    // Packed move and (piece, to) index of move played at each ply, context of move ordering
+    std::array<uint16_t, MAX_PLY + 1u> _moveStack {};
+    std::array<uint16_t, MAX_PLY + 1u> _pieceToStack {};
+    // Square of capture made at each ply plus one, zero if move was not capture
+    std::array<uint8_t, MAX_PLY + 1u> _captureStack {};
+    // Extensions accumulated on path to each ply, at most _maxExtension (half of iteration depth)
+    std::array<size_t, MAX_PLY + 1u> _pathExtension {};
+    size_t _maxExtension = 0u;
+    SearchStats _stats;
+    size_t _depth = 0u;
+    size_t _nodes = 0u;
 
     // No need of mutexes if AI is stopped from another thread
     // Negascout needs to finish ply and remaining depth nor time of stop does not matter
     std::atomic_bool _stop = false;
 
-    std::optional<MoveAndScore> countBestMove(Board& b, Color c, size_t depth) const;
-    bool kingInCheck(const Board& b, Color c) const;
-    static int negascout(Board& b, Color c, int alpha, int beta, size_t depth, const std::atomic_bool& stop);
+    // Tables of calling thread
+    void bindThread();
+    // PVS at root, pass finds best root move which is not excluded
+    void beginRoot(Board& b, Color c, RootSearch& root, size_t depth, const std::vector<Move>& excluded);
+    // Searches next root move, false once all moves are searched
+    bool searchRootMove(Board& b, Color c, RootSearch& root, const std::vector<Move>& excluded);
+    // False if pass found no move, line is left as it was
+    bool endRoot(const RootSearch& root, const std::vector<Move>& excluded, PvLine& line);
+    // Move m is best one at ply, PV of ply is m followed by PV of ply + 1
+    void updatePv(size_t ply, const Move& m);
+    void printLines(size_t depth) const;
+    void checkDeadline();
+    // Tracing instance is used only when search has trace
+    template <bool TRACE>
+    int negascout(Board& b, Color c, int alpha, int beta, size_t depth, size_t ply);
+    // Negascout of position after root move
+    int searchRootChild(Board& b, Color c, int alpha, int beta, size_t depth);
+    // Extension of move m of figure moved played at ply, cap of path is not applied
+    size_t extension(Color c, const Move& m, Square moved, bool capture, bool givesCheck, size_t ply) const;
+    // Captures only search at the bottom of negascout, losing captures by SEE are pruned
+    int quiescence(Board& b, Color c, int alpha, int beta);
+    // Quiet cutoff move gets bonus, quiet moves searched before it malus, counter move of previous move is set
+    void updateHistory(Color c, size_t ply, size_t depth, uint16_t move, uint16_t pieceTo, const uint16_t* quiets, const uint16_t* quietPieceTo, size_t numQuiets);
+    // Neither capture nor promotion
+    static bool isQuiet(const Board& b, const Move& m);
+    ScoredMoves orderedMoves(const Board& b, Color c, bool capturesOnly, uint16_t hashMove = 0u, uint16_t pvMove = 0u, size_t ply = 0u) const;
 };
@@ -0,0 +1,7 @@
+#include "arena.hpp"
+
+Arena& Arena::threadLocal()
+{
+    thread_local Arena arena(DEFAULT_SIZE);
+    return arena;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Scratch memory of one search thread, allocation only moves top of the arena
+// Search nodes open a Scope and everything allocated since is released at once when the node returns.
+// Freeing the most recent allocation moves the top back, so containers destroyed in reverse order of
+// creation give their space back immediately, other frees wait for the scope. Allocation not fitting
+// into the arena falls back to global allocator, so search never runs out of scratch memory
+class Arena {
+public:
+    // Size of thread local arenas, move lists of the deepest search path need a small part of it
+    static constexpr size_t DEFAULT_SIZE = 4u << 20u;
+
+    explicit Arena(size_t size)
+        : _buffer(new std::byte[size])
+        , _size(size)
+    {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Alignment must be a power of two not above alignment of global allocator
+    void* allocate(size_t bytes, size_t alignment)
+    {
+        const auto offset = (_top + alignment - 1u) & ~(alignment - 1u);
+        if (offset + bytes > _size) {
+            return ::operator new(bytes);
+        }
+        _top = offset + bytes;
+        return _buffer.get() + offset;
+    }
+
+    void deallocate(void* p, size_t bytes)
+    {
+        auto* ptr = static_cast<std::byte*>(p);
+        if (ptr < _buffer.get() || ptr >= _buffer.get() + _size) {
+            ::operator delete(p);
+            return;
+        }
+        if (ptr + bytes == _buffer.get() + _top) {
+            _top = static_cast<size_t>(ptr - _buffer.get());
+        }
+    }
+
+    // Bytes in use including space of freed allocations not released yet
+    size_t used() const
+    {
+        return _top;
+    }
+
+    // Releases everything allocated during its lifetime, containers using it must be destroyed first
+    class Scope {
+    public:
+        explicit Scope(Arena& arena)
+            : _arena(arena)
+            , _mark(arena._top)
+        {
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            _arena._top = _mark;
+        }
+
+    private:
+        Arena& _arena;
+        const size_t _mark;
+    };
+
+    // Arena of calling thread, allocated on first use
+    static Arena& threadLocal();
+
+private:
+    std::unique_ptr<std::byte[]> _buffer;
+    const size_t _size;
+    size_t _top = 0u;
+};
+
+// Standard allocator drawing from an arena, containers using it stay on the thread of the arena
+// Default constructed one has no arena and uses global allocator, for containers outside search
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() = default;
+
+    ArenaAllocator(Arena& arena)
+        : _arena(&arena)
+    {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : _arena(other.arena())
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (!_arena) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (!_arena) {
+            ::operator delete(p);
+            return;
+        }
+        _arena->deallocate(p, n * sizeof(T));
+    }
+
+    Arena* arena() const
+    {
+        return _arena;
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const
+    {
+        return _arena == other.arena();
+    }
+
+private:
+    Arena* _arena = nullptr;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
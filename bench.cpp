@@ -0,0 +1,169 @@
+#include "bench.hpp"
+#include "ai.hpp"
+#include "board.hpp"
+#include "board_stats.hpp"
+#include "notation.hpp"
+#include "tt.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Positions are given as move sequences from starting position
+// clang-format off
+const std::vector<std::string> BENCH_POSITIONS = {
+    "",
+    "e2e4 g8f6 e4e5 d7d5",
+    "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7 f1e1 b7b5 a4b3 d7d6 c2c3 e8g8",
+    "e2e4 c7c5 g1f3 d7d6 d2d4 c5d4 f3d4 g8f6 b1c3 a7a6",
+    "d2d4 d7d5 c2c4 e7e6 b1c3 g8f6 c1g5 f8e7 e2e3 e8g8 g1f3 b8d7",
+    "d2d4 g8f6 c2c4 g7g6 b1c3 f8g7 e2e4 d7d6 g1f3 e8g8 f1e2 e7e5 e1g1 b8c6 d4d5 c6e7",
+    "e2e4 e7e6 d2d4 d7d5 b1c3 f8b4 e4e5 c7c5 a2a3 b4c3 b2c3 g8e7",
+    "e2e4 c7c6 d2d4 d7d5 e4e5 c8f5 g1f3 e7e6 f1e2 c6c5",
+    "c2c4 e7e5 b1c3 g8f6 g1f3 b8c6 g2g3 d7d5 c4d5 f6d5 f1g2 d5b6",
+    "g1f3 d7d5 g2g3 g8f6 f1g2 e7e6 e1g1 f8e7 d2d3 e8g8",
+    "e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 c2c3 g8f6 d2d4 e5d4 c3d4 c5b4 c1d2 b4d2 b1d2 d7d5",
+    "e2e4 d7d5 e4d5 d8d5 b1c3 d5a5 d2d4 g8f6 g1f3 c8f5",
+    "d2d4 g8f6 c2c4 e7e6 b1c3 f8b4 e2e3 e8g8 f1d3 d7d5 g1f3 c7c5 e1g1",
+    "d2d4 d7d5 c2c4 c7c6 g1f3 g8f6 b1c3 d5c4 a2a4 c8f5 e2e3 e7e6 f1c4 f8b4",
+    "e2e4 e7e5 f2f4 e5f4 g1f3 g7g5 h2h4 g5g4 f3e5",
+    "e2e4 c7c5 b1c3 b8c6 g2g3 g7g6 f1g2 f8g7 d2d3 d7d6 f2f4 e7e6 g1f3 g8e7 e1g1 e8g8",
+    "d2d4 f7f5 g2g3 g8f6 f1g2 g7g6 g1f3 f8g7 e1g1 e8g8 c2c4 d7d6",
+    "e2e4 g7g6 d2d4 f8g7 b1c3 d7d6 c1e3 a7a6 d1d2 b7b5",
+    "e2e4 e7e5 g1f3 g8f6 f3e5 d7d6 e5f3 f6e4 d2d4 d6d5 f1d3",
+    "d2d4 g8f6 c2c4 c7c5 d4d5 b7b5 c4b5 a7a6 b5a6 c8a6 b1c3 d7d6",
+    "e2e4 c7c5 g1f3 e7e6 d2d4 c5d4 f3d4 b8c6 b1c3 d8c7 c1e3 a7a6 f1d3 g8f6 e1g1",
+    "e2e4 e7e5 g1f3 b8c6 d2d4 e5d4 f3d4 g8f6 d4c6 b7c6 e4e5 d8e7 d1e2 f6d5 c2c4",
+    "e2e4 e7e5 b1c3 g8f6 f2f4 d7d5 f4e5 f6e4 g1f3",
+    "d2d4 d7d5 c1f4 g8f6 e2e3 c7c5 c2c3 b8c6 b1d2 e7e6 g1f3 f8d6 f4g3 e8g8 f1d3",
+    "c2c4 c7c5 b1c3 b8c6 g2g3 g7g6 f1g2 f8g7 g1f3 e7e6 e1g1 g8e7",
+    "e2e4 c7c5 g1f3 d7d6 d2d4 c5d4 f3d4 g8f6 b1c3 g7g6 c1e3 f8g7 f2f3 e8g8 d1d2 b8c6 e1c1",
+    "d2d4 g8f6 c2c4 e7e6 g1f3 b7b6 g2g3 c8b7 f1g2 f8e7 e1g1 e8g8 b1c3 f6e4",
+    "e2e4 e7e5 g1f3 b8c6 f1b5 g8f6 e1g1 f6e4 d2d4 e4d6 b5c6 d7c6 d4e5 d6f5 d1d8 e8d8",
+    "d2d4 d7d5 c2c4 d5c4 g1f3 g8f6 e2e3 e7e6 f1c4 c7c5 e1g1 a7a6",
+    "e2e4 d7d6 d2d4 g8f6 b1c3 g7g6 f2f4 f8g7 g1f3 c7c5",
+    "e2e4 e7e5 g1f3 b8c6 f1c4 g8f6 f3g5 d7d5 e4d5 c6a5 c4b5 c7c6 d5c6 b7c6 b5e2 h7h6",
+    "d2d4 g8f6 c2c4 g7g6 b1c3 d7d5 c4d5 f6d5 e2e4 d5c3 b2c3 f8g7 f1c4 c7c5 g1e2 b8c6 c1e3 e8g8",
+    "e2e4 c7c5 g1f3 b8c6 d2d4 c5d4 f3d4 g8f6 b1c3 e7e5 d4b5 d7d6 c1g5 a7a6 b5a3 b7b5",
+    "e2e4 e7e6 d2d4 d7d5 e4d5 e6d5 g1f3 g8f6 f1d3 f8d6 e1g1 e8g8 c1g5 c8g4",
+    "b2b3 e7e5 c1b2 b8c6 e2e3 d7d5 f1b5 f8d6",
+    "e2e4 e7e5 d2d4 e5d4 d1d4 b8c6 d4e3 g8f6 b1c3 f8b4 c1d2 e8g8 e1c1 f8e8",
+    "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7 f1e1 b7b5 a4b3 d7d6 c2c3 e8g8 "
+    "h2h3 c8b7 d2d4 f8e8 b1d2 e7f8 a2a4 h7h6 b3c2 e5d4 c3d4 c6b4 c2b1 c7c5 d4d5 f6d7 a1a3 f7f5",
+    "e2e4 e7e5 d2d4 e5d4 d1d4 d8f6 d4f6 g8f6 c1g5 f8b4 c2c3 b4c5 g5f6 g7f6 b1d2 b8c6 g1f3 d7d6 f1b5 c8d7 b5c6 d7c6",
+    "d2d4 e7e6 c2c4 f8b4 c1d2 b4d2 d1d2 g8f6 b1c3 d7d5 c4d5 e6d5 e2e3 e8g8 f1d3 c7c6 g1e2 f8e8 e1g1",
+    "e2e4 c7c6 d2d4 d7d5 b1c3 d5e4 c3e4 c8f5 e4g3 f5g6 h2h4 h7h6 g1f3 b8d7 h4h5 g6h7 f1d3 h7d3 d1d3 d8c7 c1d2 e7e6 e1c1 g8f6",
+    "d2d4 g8f6 g1f3 e7e6 c1g5 c7c5 e2e3 b7b6 b1d2 c8b7 f1d3 f8e7 c2c3 e8g8 e1g1 d7d6",
+    "e2e4 e7e5 g1f3 d7d6 d2d4 e5d4 f3d4 g8f6 b1c3 f8e7 f1e2 e8g8 e1g1 f8e8",
+    "e2e4 b8c6 d2d4 d7d5 e4e5 c8f5 c2c3 e7e6 g1f3 f7f6",
+    "g2g3 g7g6 f1g2 f8g7 e2e4 e7e5 g1e2 g8e7 e1g1 e8g8",
+    "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5c6 d7c6 e1g1 f7f6 d2d4 e5d4 f3d4 c6c5 d4b3 d8d1 f1d1",
+    "d2d4 d7d5 c2c4 e7e6 b1c3 c7c5 c4d5 e6d5 g1f3 b8c6 g2g3 g8f6 f1g2 f8e7 e1g1 e8g8 c1g5 c5d4 f3d4 h7h6",
+    "e2e4 c7c5 c2c3 d7d5 e4d5 d8d5 d2d4 g8f6 g1f3 c8g4 f1e2 e7e6 e1g1 b8c6",
+    "f2f4 d7d5 g1f3 g8f6 e2e3 g7g6 b2b3 f8g7 c1b2 e8g8 f1e2 c7c5 e1g1 b8c6",
+    "e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 b2b4 c5b4 c2c3 b4a5 d2d4 e5d4 e1g1 d4c3",
+    "d2d4 g8f6 c2c4 e7e5 d4e5 f6g4 c1f4 b8c6 g1f3 f8b4 b1d2 d8e7 a2a3 g4e5 a3b4 e5d3",
+};
+// clang-format on
+
+struct BenchResult {
+    size_t nodes = 0u;
+    std::optional<Move> bestMove;
+    std::vector<IterationStats> iterationStats;
+};
+
+BenchResult searchPosition(const std::string& moves, size_t depth)
+{
+    Board board;
+    BoardStats boardStats;
+    auto color = Color::WHITE;
+
+    std::istringstream is(moves);
+    for (std::string str; is >> str;) {
+        const auto m = findMove(board, color, str);
+        if (!m) {
+            throw std::runtime_error("Bench - invalid move " + str);
+        }
+        board.applyMove(*m);
+        board.clearUndoMoves();
+        boardStats.visit(board);
+        color = enemyColor(color);
+    }
+
+    // Every position starts with empty tables, so node counts do not depend on scheduling
+    TranspositionTable::threadLocal().clear();
+    SearchHistory::threadLocal().clear();
+    AI ai(board, color, boardStats);
+    ai.setMaxDepth(depth);
+    ai.run();
+
+    return BenchResult { ai.nodes(), ai.bestMove(), ai.iterationStats() };
+}
+
+} // namespace
+
+void runBench(const BenchConfig& config)
+{
+    using namespace std::chrono;
+
+    TranspositionTable::setDefaultSize(config.hash);
+    const auto numPositions = BENCH_POSITIONS.size();
+    std::vector<BenchResult> results(numPositions);
+    std::atomic_size_t next = 0u;
+
+    const auto start = steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0u; i < std::max<size_t>(config.threads, 1u); i++) {
+        workers.emplace_back([&] {
+            for (size_t pos = next++; pos < numPositions; pos = next++) {
+                results[pos] = searchPosition(BENCH_POSITIONS[pos], config.depth);
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    const auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+
+    size_t totalNodes = 0u;
+    for (size_t i = 0u; i < numPositions; i++) {
+        const auto& r = results[i];
+        std::cout << "Position " << (i + 1) << '/' << numPositions << ": ";
+        if (r.bestMove) {
+            std::cout << *r.bestMove;
+        } else {
+            std::cout << "none";
+        }
+        std::cout << ", nodes " << r.nodes << std::endl;
+        totalNodes += r.nodes;
+    }
+
+    if (!config.statsFile.empty()) {
+        std::ofstream stats(config.statsFile);
+        for (size_t i = 0u; i < numPositions; i++) {
+            for (const auto& s : results[i].iterationStats) {
+                stats << "{\"position\":" << (i + 1) << ",\"iteration\":" << s << "}\n";
+            }
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "===========================" << std::endl;
+    std::cout << "Depth           : " << config.depth << std::endl;
+    std::cout << "Threads         : " << config.threads << std::endl;
+    std::cout << "Hash (MB)       : " << config.hash << std::endl;
+    std::cout << "Total time (ms) : " << elapsed << std::endl;
+    std::cout << "Nodes searched  : " << totalNodes << std::endl;
+    std::cout << "Nodes/second    : " << (totalNodes * 1000u / std::max<long long>(elapsed, 1)) << std::endl;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct BenchConfig {
+    // Negascout depth, two = one ply
+    size_t depth = 4u;
+    size_t threads = 1u;
+    // Transposition table size in MB per thread, zero disables it
+    size_t hash = 16u;
+    // Search statistics as JSON lines, needs MCE_SEARCH_STATS build
+    std::string statsFile;
+};
+
+// Searches built-in position suite to fixed depth and prints total nodes, time and nps
+// Total nodes are a signature of the search, it must not change for non-functional changes
+void runBench(const BenchConfig& config);
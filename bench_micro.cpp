@@ -0,0 +1,368 @@
+#include "ai.hpp"
+#include "board.hpp"
+#include "board_stats.hpp"
+#include "fen.hpp"
+#include "history.hpp"
+#include "tt.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Allocation counting hook, every kernel reports calls into global allocator per operation
+namespace {
+
+size_t allocations = 0u;
+
+// Null if out of memory, aligned_alloc needs size to be multiple of alignment
+void* countedAllocation(size_t size, size_t alignment)
+{
+    allocations++;
+    size = std::max<size_t>(size, 1u);
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    return std::aligned_alloc(alignment, (size + alignment - 1u) / alignment * alignment);
+}
+
+} // namespace
+
+// Array forms call these, so every variant is counted and freed by free()
+void* operator new(size_t size)
+{
+    if (auto* p = countedAllocation(size, alignof(std::max_align_t))) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (auto* p = countedAllocation(size, static_cast<size_t>(alignment))) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+// Microbenchmarks of engine hot paths over fixed position corpus
+// mce_bench_micro [samples] [--json]
+// Every kernel runs over whole corpus, reported times are nanoseconds per operation
+// Search kernel operation is one negascout node, so its allocations per operation show heap use of the hot loop
+
+namespace {
+
+constexpr auto WARMUP_SAMPLES = 3u;
+constexpr auto DEFAULT_SAMPLES = 25u;
+// Corpus passes per sample, keeps a sample well above clock resolution
+constexpr auto PASSES_PER_SAMPLE = 200u;
+// Search kernel does fewer passes, one pass searches every position
+constexpr auto SEARCH_DEPTH = 4u;
+
+// clang-format off
+const std::vector<std::string> CORPUS = {
+    STARTING_FEN,
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "r1bq1rk1/2p1bppp/p1np1n2/1p2p3/4P3/1BP2N2/PP1P1PPP/RNBQR1K1 w - - 0 9",
+    "rnbq1rk1/ppp1ppbp/3p1np1/8/2PPP3/2N2N2/PP2BPPP/R1BQK2R b KQ - 3 6",
+    "r2q1rk1/pp2ppbp/2np1np1/8/3NP3/2N1BP2/PPPQ2PP/2KR1B1R b - - 5 10",
+    "r1bqk2r/pp2bppp/2n1pn2/2pp4/3P4/2PBPN2/PP1N1PPP/R1BQK2R w KQkq - 4 7",
+    "r4rk1/1bqnbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 2 13",
+    "2r2rk1/pp1bqppp/2n1pn2/3p4/2PP4/P1N1PN2/1P1QBPPP/R4RK1 w - - 1 14",
+    "r3kb1r/pp1n1ppp/2p1pn2/q7/2BP4/2N2N2/PPPB1PPP/R2QK2R w KQkq - 2 9",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+    "8/8/8/4k3/8/8/4P3/4K3 b - - 0 1",
+    "8/5pk1/6p1/3R4/7P/6P1/r4PK1/8 b - - 3 40",
+    "8/8/3k4/8/2QK4/8/8/8 w - - 0 1",
+    "4r1k1/p4ppp/1p6/2p5/2P5/1P4P1/P4P1P/4R1K1 w - - 0 25",
+    "2kr3r/ppp2ppp/2n5/2b1p3/4P1q1/2NP2P1/PPPB1P1P/R2QK2R w KQ - 0 12",
+};
+// clang-format on
+
+struct Result {
+    std::string name;
+    size_t opsPerSample = 0u;
+    std::vector<double> nsPerOp;
+    // Calls into global allocator per operation over all samples
+    double allocsPerOp = 0.0;
+
+    double percentile(double p) const
+    {
+        auto sorted = nsPerOp;
+        std::sort(sorted.begin(), sorted.end());
+        const auto i = static_cast<size_t>(p * (sorted.size() - 1u) + 0.5);
+        return sorted[i];
+    }
+};
+
+// Defeats dead code elimination of benchmarked kernels
+volatile size_t sink = 0u;
+
+// Kernel runs over whole corpus once and returns number of operations done
+using Kernel = std::function<size_t(std::vector<Position>&)>;
+
+Result measure(const std::string& name, std::vector<Position>& corpus, size_t samples, size_t passes, const Kernel& kernel)
+{
+    using namespace std::chrono;
+
+    Result result {};
+    result.name = name;
+    size_t totalOps = 0u;
+    size_t totalAllocations = 0u;
+
+    for (size_t s = 0u; s < WARMUP_SAMPLES + samples; s++) {
+        size_t ops = 0u;
+        const auto allocationsBefore = allocations;
+        const auto start = steady_clock::now();
+        for (size_t i = 0u; i < passes; i++) {
+            ops += kernel(corpus);
+        }
+        const auto ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        if (s >= WARMUP_SAMPLES) {
+            result.opsPerSample = ops;
+            result.nsPerOp.push_back(static_cast<double>(ns) / std::max<size_t>(ops, 1u));
+            totalOps += ops;
+            totalAllocations += allocations - allocationsBefore;
+        }
+    }
+    result.allocsPerOp = static_cast<double>(totalAllocations) / std::max<size_t>(totalOps, 1u);
+    return result;
+}
+
+size_t moveGeneration(std::vector<Position>& corpus)
+{
+    size_t moves = 0u;
+    for (const auto& p : corpus) {
+        for (auto generator = p.board.moveGenerator(p.color); generator.hasMoves();) {
+            moves += generator.movesChunk().size();
+        }
+    }
+    sink = sink + moves;
+    return corpus.size();
+}
+
+Kernel applyUndoMove(const std::vector<Position>& corpus)
+{
+    // Moves are generated upfront, kernel measures only apply/undo pair
+    std::vector<Moves> moves;
+    for (const auto& p : corpus) {
+        moves.emplace_back();
+        for (auto generator = p.board.moveGenerator(p.color); generator.hasMoves();) {
+            for (const auto& m : generator.movesChunk()) {
+                moves.back().push_back(m);
+            }
+        }
+    }
+    return [moves](std::vector<Position>& corpus) {
+        size_t ops = 0u;
+        for (size_t i = 0u; i < corpus.size(); i++) {
+            auto& b = corpus[i].board;
+            for (const auto& m : moves[i]) {
+                const auto undos = b.applyMove(m);
+                sink = sink + b.hash();
+                b.undoMove(undos);
+                ops++;
+            }
+        }
+        return ops;
+    };
+}
+
+size_t evaluation(std::vector<Position>& corpus)
+{
+    for (const auto& p : corpus) {
+        int score = 0;
+        for (auto figures = occupiedMask(p.board.squares()); figures != 0u; figures &= figures - 1u) {
+            const auto pos = std::countr_zero(figures);
+            const auto sq = p.board.get(pos);
+            score += figureScore(figure(sq), color(sq), pos);
+        }
+        sink = sink + score;
+    }
+    return corpus.size();
+}
+
+size_t kingInCheck(std::vector<Position>& corpus)
+{
+    for (const auto& p : corpus) {
+        sink = sink + p.board.kingInCheck(p.color);
+    }
+    return corpus.size();
+}
+
+size_t boardSetup(std::vector<Position>& corpus)
+{
+    for (const auto& p : corpus) {
+        const Board b(p.board.squares());
+        sink = sink + b.hash() + b.score();
+    }
+    return corpus.size();
+}
+
+Kernel boardStatsLookup()
+{
+    // Visited positions include corpus and all positions one move away
+    auto stats = std::make_shared<BoardStats>();
+    for (auto& p : CORPUS) {
+        auto position = parseFen(p);
+        stats->visit(position.board);
+        for (auto generator = position.board.moveGenerator(position.color); generator.hasMoves();) {
+            for (const auto& m : generator.movesChunk()) {
+                const auto undos = position.board.applyMove(m);
+                stats->visit(position.board);
+                position.board.undoMove(undos);
+            }
+        }
+    }
+    return [stats](std::vector<Position>& corpus) {
+        for (const auto& p : corpus) {
+            sink = sink + stats->threeFoldRepetition(p.board);
+        }
+        return corpus.size();
+    };
+}
+
+size_t search(std::vector<Position>& corpus)
+{
+    // Tables are cleared, so every pass searches the same tree
+    size_t nodes = 0u;
+    for (auto& p : corpus) {
+        TranspositionTable::threadLocal().clear();
+        SearchHistory::threadLocal().clear();
+        BoardStats stats;
+        AI ai(p.board, p.color, stats);
+        ai.setMaxDepth(SEARCH_DEPTH);
+        ai.run();
+        nodes += ai.nodes();
+    }
+    return nodes;
+}
+
+void printTable(const std::vector<Result>& results)
+{
+    std::cout << std::left << std::setw(20) << "kernel"
+              << std::right << std::setw(12) << "median ns"
+              << std::setw(12) << "p10 ns"
+              << std::setw(12) << "p90 ns"
+              << std::setw(12) << "ops/sample"
+              << std::setw(12) << "allocs/op" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(20) << r.name
+                  << std::right << std::setw(12) << r.percentile(0.5)
+                  << std::setw(12) << r.percentile(0.1)
+                  << std::setw(12) << r.percentile(0.9)
+                  << std::setw(12) << r.opsPerSample
+                  << std::setw(12) << std::setprecision(4) << r.allocsPerOp << std::setprecision(2) << std::endl;
+    }
+}
+
+void printJson(const std::vector<Result>& results)
+{
+    for (const auto& r : results) {
+        std::cout << "{\"kernel\":\"" << r.name << "\""
+                  << ",\"samples\":" << r.nsPerOp.size()
+                  << ",\"ops_per_sample\":" << r.opsPerSample
+                  << ",\"median_ns\":" << r.percentile(0.5)
+                  << ",\"p10_ns\":" << r.percentile(0.1)
+                  << ",\"p90_ns\":" << r.percentile(0.9)
+                  << ",\"min_ns\":" << r.percentile(0.0)
+                  << ",\"max_ns\":" << r.percentile(1.0)
+                  << ",\"allocs_per_op\":" << r.allocsPerOp
+                  << "}" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t samples = DEFAULT_SAMPLES;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            samples = std::max<size_t>(std::stoul(argv[i]), 1u);
+        }
+    }
+
+    std::vector<Position> corpus;
+    for (const auto& fen : CORPUS) {
+        corpus.push_back(parseFen(fen));
+    }
+
+    const std::vector<std::tuple<std::string, size_t, Kernel>> kernels = {
+        { "movegen", PASSES_PER_SAMPLE, moveGeneration },
+        { "apply_undo", PASSES_PER_SAMPLE, applyUndoMove(corpus) },
+        { "evaluation", PASSES_PER_SAMPLE, evaluation },
+        { "king_in_check", PASSES_PER_SAMPLE, kingInCheck },
+        { "board_stats_lookup", PASSES_PER_SAMPLE, boardStatsLookup() },
+        { "board_setup", PASSES_PER_SAMPLE, boardSetup },
+        { "search", 1u, search },
+    };
+
+    std::vector<Result> results;
+    for (const auto& [name, passes, kernel] : kernels) {
+        results.push_back(measure(name, corpus, samples, passes, kernel));
+    }
+
+    if (json) {
+        printJson(results);
+    } else {
+        printTable(results);
+    }
+    return 0;
+}
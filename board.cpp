@@ -1,41 +1,97 @@
 #include "board.hpp"
 #include "figure_moves.hpp"
+#include "search_stats.hpp"
+#include "zobrist.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <iostream>
 
+namespace {
+
+// King is worth more than everything else together
+constexpr int SEE_KING_VALUE = 20000;
+
+// Straight rays first, then diagonal ones
+constexpr std::array<std::pair<int, int>, 8u> SEE_RAYS = { {
+    { 1, 0 },
+    { -1, 0 },
+    { 0, 1 },
+    { 0, -1 },
+    { 1, 1 },
+    { 1, -1 },
+    { -1, 1 },
+    { -1, -1 },
+} };
+
+constexpr std::array<std::pair<int, int>, 8u> KNIGHT_OFFSETS = { {
+    { 1, 2 },
+    { 2, 1 },
+    { 2, -1 },
+    { 1, -2 },
+    { -1, -2 },
+    { -2, -1 },
+    { -2, 1 },
+    { -1, 2 },
+} };
+
+int exchangeValue(Figure f)
+{
+    return (f == Figure::KING || f == Figure::KING_IDLE) ? SEE_KING_VALUE : figureValue(f);
+}
+
+// Figure standing distance squares away from target in (dx, dy) direction with nothing in between
+bool rayAttacker(Square sq, int dx, int dy, int distance)
+{
+    const bool diagonal = dx != 0 && dy != 0;
+
+    switch (figure(sq)) {
+    case Figure::QUEEN:
+        return true;
+    case Figure::ROOK:
+    case Figure::ROOK_IDLE:
+        return !diagonal;
+    case Figure::BISHOP:
+        return diagonal;
+    case Figure::KING:
+    case Figure::KING_IDLE:
+        return distance == 1;
+    case Figure::PAWN:
+    case Figure::PAWN_IDLE:
+    case Figure::PAWN_EN_PASSANT:
+        // White pawns capture upwards, so they attack from below
+        return diagonal && distance == 1 && dy == (color(sq) == Color::WHITE ? -1 : 1);
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
 Board::MoveGenerator::MoveGenerator(const Board& b, Color c)
     : _board(b)
-    , _color(c)
+    , _figures(b.colorMask(c))
 {
 }
 
-Moves Board::MoveGenerator::movesChunk()
+MoveList Board::MoveGenerator::movesChunk()
 {
-    while (hasMoves()) {
-        const auto sq = _board.get(_x, _y);
-        if (color(sq) != _color) {
-            nextSquare();
-            continue;
-        }
-        const auto f = figure(sq);
-        if (f == Figure::NONE) {
-            nextSquare();
-            continue;
-        }
-        const auto moves = figureMoves(f, _board, _x, _y);
-        nextSquare();
-        return moves;
-    }
-    return {};
+    MoveList moves;
+    movesChunk(moves);
+    return moves;
 }
 
-void Board::MoveGenerator::nextSquare()
+void Board::MoveGenerator::movesChunk(MoveList& moves)
 {
-    _x++;
-    if (_x >= Board::WIDTH) {
-        _x = 0;
-        _y++;
+    if (!hasMoves()) {
+        return;
     }
+    const auto pos = std::countr_zero(_figures);
+    _figures &= _figures - 1u;
+    [[maybe_unused]] const auto size = moves.size();
+    figureMoves(figure(_board.get(pos)), _board, pos % Board::WIDTH, pos / Board::WIDTH, moves);
+    SEARCH_STAT_ADD(generatedMoves, moves.size() - size);
 }
 
 Board::Board()
@@ -66,31 +122,194 @@ Board::Board()
     set(3, 7, square(Figure::QUEEN, Color::BLACK));
     set(4, 0, square(Figure::KING_IDLE, Color::WHITE));
     set(4, 7, square(Figure::KING_IDLE, Color::BLACK));
+
+    setNetwork(nnue::defaultNetwork());
+}
+
+Board::Board(const BoardType& squares)
+{
+    _board.fill(EMPTY_SQUARE);
+
+    for (auto figures = occupiedMask(squares); figures != 0u; figures &= figures - 1u) {
+        const auto pos = std::countr_zero(figures);
+        const auto sq = squares[pos];
+        set(pos, sq);
+        _score += figureScore(figure(sq), color(sq), pos);
+    }
+
+    setNetwork(nnue::defaultNetwork());
+}
+
+void Board::setNetwork(const nnue::Network* network)
+{
+    _network = network;
+    if (_network) {
+        _network->refresh(_accumulator, _board);
+    }
 }
 
 void Board::set(int pos, Square sq)
 {
+    const auto oldSq = _board[pos];
+    if (_network) {
+        _network->update(_accumulator, pos, oldSq, sq);
+    }
     _board[pos] = sq;
 
-    if (sq == EMPTY_SQUARE) {
-        _hash &= ~(1 << pos);
-    } else {
-        _hash |= (1 << pos);
+    _hash ^= zobrist::squareKey(oldSq, pos) ^ zobrist::squareKey(sq, pos);
+    _pawnHash ^= zobrist::pawnKey(oldSq, pos) ^ zobrist::pawnKey(sq, pos);
+    _figures += (figure(sq) != Figure::NONE) - (figure(oldSq) != Figure::NONE);
+
+    const auto fig = figure(sq);
+    if (fig == Figure::KING || fig == Figure::KING_IDLE) {
+        _kings[static_cast<size_t>(color(sq))] = pos;
     }
 }
 
 Point Board::kingPosition(Color c) const
 {
-    for (int x = 0; x < WIDTH; x++) {
-        for (int y = 0; y < HEIGHT; y++) {
+    // Last square king was set to, it may be captured since then
+    const auto pos = _kings[static_cast<size_t>(c)];
+    const auto sq = get(pos);
+    const auto fig = figure(sq);
+    if (color(sq) == c && (fig == Figure::KING || fig == Figure::KING_IDLE)) {
+        return Point { pos % WIDTH, pos / WIDTH };
+    }
+    throw std::runtime_error("King not found!");
+}
+
+bool Board::kingInCheck(Color c) const
+{
+    const auto king = kingPosition(c);
+    return attacked(king.x, king.y, enemyColor(c));
+}
+
+bool Board::attacked(int x, int y, Color by) const
+{
+    // Nearest figure on every ray
+    for (const auto& [dx, dy] : SEE_RAYS) {
+        for (int distance = 1; validIndex(x + dx * distance, y + dy * distance); distance++) {
+            const auto sq = get(x + dx * distance, y + dy * distance);
+            if (figure(sq) == Figure::NONE) {
+                continue;
+            }
+            if (color(sq) == by && rayAttacker(sq, dx, dy, distance)) {
+                return true;
+            }
+            break;
+        }
+    }
+    for (const auto& [dx, dy] : KNIGHT_OFFSETS) {
+        if (validIndex(x + dx, y + dy) && get(x + dx, y + dy) == square(Figure::KNIGHT, by)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Board::see(const Move& m) const
+{
+    if (m.type == MoveType::CASTLING) {
+        return 0;
+    }
+    const auto tx = m.to.x;
+    const auto ty = m.to.y;
+    const auto mover = get(m.from.x, m.from.y);
+
+    // Figures which already took part in exchange, uncovers x-ray attackers behind them
+    uint64_t used = uint64_t { 1u } << position(m.from.x, m.from.y);
+    const auto isUsed = [&used](int x, int y) {
+        return (used & (uint64_t { 1u } << position(x, y))) != 0u;
+    };
+
+    // Distance of nearest unused figure on every ray, zero if there is none
+    std::array<int, SEE_RAYS.size()> rayFront {};
+    const auto advanceRay = [&](size_t r, int distance) {
+        const auto [dx, dy] = SEE_RAYS[r];
+        for (; validIndex(tx + dx * distance, ty + dy * distance); distance++) {
+            const auto x = tx + dx * distance;
+            const auto y = ty + dy * distance;
+            if (figure(get(x, y)) != Figure::NONE && !isUsed(x, y)) {
+                rayFront[r] = distance;
+                return;
+            }
+        }
+        rayFront[r] = 0;
+    };
+    for (size_t r = 0u; r < SEE_RAYS.size(); r++) {
+        advanceRay(r, 1);
+    }
+
+    struct Attacker {
+        int x = -1;
+        int y = -1;
+        int value = 0;
+        int ray = -1;
+    };
+    const auto leastValuableAttacker = [&](Color side) {
+        Attacker best;
+        for (size_t r = 0u; r < SEE_RAYS.size(); r++) {
+            if (rayFront[r] == 0) {
+                continue;
+            }
+            const auto [dx, dy] = SEE_RAYS[r];
+            const auto x = tx + dx * rayFront[r];
+            const auto y = ty + dy * rayFront[r];
+            const auto sq = get(x, y);
+            const auto value = exchangeValue(figure(sq));
+            if (color(sq) == side && rayAttacker(sq, dx, dy, rayFront[r]) && (best.x < 0 || value < best.value)) {
+                best = Attacker { x, y, value, static_cast<int>(r) };
+            }
+        }
+        for (const auto& [dx, dy] : KNIGHT_OFFSETS) {
+            const auto x = tx + dx;
+            const auto y = ty + dy;
+            if (!validIndex(x, y) || isUsed(x, y)) {
+                continue;
+            }
             const auto sq = get(x, y);
-            const auto fig = figure(sq);
-            if (color(sq) == c && (fig == Figure::KING || fig == Figure::KING_IDLE)) {
-                return Point { x, y };
+            const auto value = exchangeValue(figure(sq));
+            if (figure(sq) == Figure::KNIGHT && color(sq) == side && (best.x < 0 || value < best.value)) {
+                best = Attacker { x, y, value, -1 };
             }
         }
+        return best;
+    };
+
+    std::array<int, 40u> gain;
+    int d = 0;
+    gain[0] = m.type == MoveType::EN_PASSANT ? figureValue(Figure::PAWN) : exchangeValue(figure(get(tx, ty)));
+    // Promotion, figure standing on target square is not the one which moved
+    if (figure(m.toSq) == Figure::QUEEN && figure(mover) != Figure::QUEEN) {
+        gain[0] += figureValue(Figure::QUEEN) - figureValue(Figure::PAWN);
     }
-    throw std::runtime_error("King not found!");
+    int onSquare = exchangeValue(figure(m.toSq));
+    auto side = enemyColor(color(mover));
+
+    while (d + 1 < static_cast<int>(gain.size())) {
+        d++;
+        // Speculative, valid only if side has an attacker
+        gain[d] = onSquare - gain[d - 1];
+        const auto attacker = leastValuableAttacker(side);
+        if (attacker.x < 0) {
+            break;
+        }
+        if (attacker.value == SEE_KING_VALUE && leastValuableAttacker(enemyColor(side)).x >= 0) {
+            // King cannot capture defended figure
+            break;
+        }
+        onSquare = attacker.value;
+        used |= uint64_t { 1u } << position(attacker.x, attacker.y);
+        if (attacker.ray >= 0) {
+            advanceRay(attacker.ray, rayFront[attacker.ray] + 1);
+        }
+        side = enemyColor(side);
+    }
+
+    while (--d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    }
+    return gain[0];
 }
 
 size_t Board::applyMove(const Move& m)
@@ -102,6 +321,21 @@ size_t Board::applyMove(const Move& m)
     const auto toSqCol = color(toSq);
     const auto toSqFig = figure(toSq);
 
+    // En passant right lasts one ply, pawn double pushed on mover's previous move loses its flag
+    // (moving pawn loses it by the move itself)
+    size_t expired = 0u;
+    const int epY = fromSqCol == Color::WHITE ? 3 : 4;
+    for (int x = 0; x < WIDTH; x++) {
+        const auto sq = get(x, epY);
+        if (sq == square(Figure::PAWN_EN_PASSANT, fromSqCol) && (x != m.from.x || epY != m.from.y)) {
+            const auto pos = position(x, epY);
+            _undoMoves.emplace_back(UndoMove { x, epY, x, epY, sq, sq, _score });
+            _score += figureScore(Figure::PAWN, fromSqCol, pos) - figureScore(Figure::PAWN_EN_PASSANT, fromSqCol, pos);
+            set(pos, square(Figure::PAWN, fromSqCol));
+            expired++;
+        }
+    }
+
     _undoMoves.emplace_back(UndoMove { m.from, m.to, fromSq, toSq, _score });
     _score -= figureScore(fromSqFig, fromSqCol, position(m.from.x, m.from.y));
     _score -= figureScore(toSqFig, toSqCol, position(m.to.x, m.to.y));
@@ -115,7 +349,7 @@ size_t Board::applyMove(const Move& m)
         const int fx = (m.from.x < m.to.x) ? 7 : 0;
         const int tx = m.to.x - (m.from.x < m.to.x ? 1 : -1);
         const int y = m.to.y;
-        return applyMove(Move { fx, y, tx, m.to.y, square(Figure::ROOK, fromSqCol) }) + 1u;
+        return applyMove(Move { fx, y, tx, m.to.y, square(Figure::ROOK, fromSqCol) }) + expired + 1u;
     }
     if (m.type == MoveType::EN_PASSANT) {
         const int x = m.to.x;
@@ -124,10 +358,10 @@ size_t Board::applyMove(const Move& m)
         _undoMoves.emplace_back(UndoMove { x, y, x, y, sq, sq, _score });
         _score -= figureScore(figure(sq), color(sq), position(x, y));
         set(x, y, EMPTY_SQUARE);
-        return 2u;
+        return expired + 2u;
     }
 
-    return 1u;
+    return expired + 1u;
 }
 
 void Board::undoMove(size_t numUndoMoves)
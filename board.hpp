@@ -2,8 +2,11 @@
 
 #include "figures.hpp"
 #include "move.hpp"
+#include "nnue.hpp"
+#include "square_masks.hpp"
 
 #include <array>
+#include <cstdint>
 
 class Board {
 public:
@@ -19,23 +22,26 @@ public:
         MoveGenerator() = delete;
         MoveGenerator(const Board& b, Color c);
 
-        Moves movesChunk();
+        // Moves of next figure on heap, for callers outside search
+        MoveList movesChunk();
+        // Appends moves of next figure to list, search generates into its scratch memory this way
+        void movesChunk(MoveList& moves);
 
         bool hasMoves() const
         {
-            return _y < Board::HEIGHT;
+            return _figures != 0u;
         }
 
     private:
         const Board& _board;
-        const Color _color;
-        int _x = 0;
-        int _y = 0;
-
-        void nextSquare();
+        // Squares of figures whose moves were not generated yet, board must not change meanwhile
+        uint64_t _figures;
     };
 
+    // Starting position
     Board();
+    // Arbitrary position, score and hash are computed from scratch
+    explicit Board(const BoardType& squares);
 
     constexpr Square get(int pos) const
     {
@@ -54,11 +60,34 @@ public:
 
     void set(int pos, Square sq);
 
+    const BoardType& squares() const
+    {
+        return _board;
+    }
+
+    // Incrementally updated PST score from white's point of view
     int score() const
     {
         return _score;
     }
 
+    // Static evaluation from c's point of view, network if attached otherwise PST score
+    int evaluate(Color c) const
+    {
+        if (_network && !kingCaptured()) {
+            return _network->evaluate(_accumulator, c);
+        }
+        return c == Color::WHITE ? _score : -_score;
+    }
+
+    // nullptr switches back to PST evaluation, accumulator is computed from scratch
+    void setNetwork(const nnue::Network* network);
+
+    const nnue::Network* network() const
+    {
+        return _network;
+    }
+
     MoveGenerator moveGenerator(Color c) const
     {
         return MoveGenerator(*this, c);
@@ -69,17 +98,54 @@ public:
         return std::abs(_score) >= KING_CAPTURED_MIN_SCORE;
     }
 
+    // Number of figures on board, kings included
+    int figureCount() const
+    {
+        return _figures;
+    }
+
+    // Bit per square position of figures of color c
+    uint64_t colorMask(Color c) const
+    {
+        return ::colorMask(_board, c);
+    }
+
+    // Bit per square position of squares holding sq
+    uint64_t squareMask(Square sq) const
+    {
+        return ::squareMask(_board, 0xFF, sq);
+    }
+
+    // Zobrist key of squares, side to move is not included
     size_t hash() const
     {
         return _hash;
     }
 
+    // Zobrist key of pawns only
+    size_t pawnHash() const
+    {
+        return _pawnHash;
+    }
+
     bool operator==(const Board& b) const
     {
         return b._hash == _hash && b._board == _board;
     }
 
     Point kingPosition(Color c) const;
+    bool kingInCheck(Color c) const;
+    // Square is attacked by figure of color by, ray scan from the square
+    bool attacked(int x, int y, Color by) const;
+
+    bool isCapture(const Move& m) const
+    {
+        return m.type == MoveType::EN_PASSANT || enemy(get(m.from.x, m.from.y), get(m.to.x, m.to.y));
+    }
+
+    // Static exchange evaluation, material balance of capture sequence on move's target square
+    // from mover's point of view, both sides always recapture with least valuable attacker
+    int see(const Move& m) const;
 
     size_t applyMove(const Move& m);
     void undoMove(size_t numUndoMoves);
@@ -88,6 +154,12 @@ public:
         _undoMoves.clear();
     }
 
+    // Room for this many more undo moves, applyMove does not allocate within it
+    void reserveUndoMoves(size_t numUndoMoves)
+    {
+        _undoMoves.reserve(_undoMoves.size() + numUndoMoves);
+    }
+
     static constexpr bool validIndex(int x, int y)
     {
         return x >= 0 && y >= 0 && x < WIDTH && y < HEIGHT;
@@ -98,7 +170,13 @@ private:
 
     BoardType _board;
     UndoMoves _undoMoves;
+    const nnue::Network* _network = nullptr;
+    nnue::Accumulator _accumulator;
     size_t _hash = 0u;
+    size_t _pawnHash = 0u;
+    // Indexed by color, kept by set so king lookup does not scan the board
+    std::array<int, 2u> _kings = { 0, 0 };
+    int _figures = 0;
     int _score = 0;
 
     // Using int instead of size_t everywhere due to negative integers
@@ -10,24 +10,47 @@ public:
 
     bool threeFoldRepetition(const Board& b) const
     {
-        const auto it = _visits.find(b);
+        const auto it = _visits.find(key(b));
         if (it == _visits.end()) {
             return false;
         }
         return it->second >= 2u;
     }
 
+    size_t visits(const Board& b) const
+    {
+        const auto it = _visits.find(key(b));
+        return it == _visits.end() ? 0u : it->second;
+    }
+
     void visit(const Board& b)
     {
-        _visits[b]++;
+        _visits[key(b)]++;
     }
 
 private:
-    struct BoardHash {
-        size_t operator()(const Board& b) const
+    // Only squares are stored, copying whole board would copy its undo moves too
+    struct BoardKey {
+        Board::BoardType squares;
+        size_t hash;
+
+        bool operator==(const BoardKey& k) const
+        {
+            return hash == k.hash && squares == k.squares;
+        }
+    };
+
+    struct BoardKeyHash {
+        size_t operator()(const BoardKey& k) const
         {
-            return b.hash();
+            return k.hash;
         }
     };
-    std::unordered_map<Board, size_t, BoardHash> _visits;
-};
\ No newline at end of file
+
+    std::unordered_map<BoardKey, size_t, BoardKeyHash> _visits;
+
+    static BoardKey key(const Board& b)
+    {
+        return BoardKey { b.squares(), b.hash() };
+    }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+// Polyglot opening book (.bin)
+//
+// File is memory mapped as is, it is array of 16 B big endian entries sorted by key:
+//   uint64 key, uint16 move, uint16 weight, uint32 learn
+// Move bits are to file (0-2), to rank (3-5), from file (6-8), from rank (9-11) and
+// promotion (12-14, 0 none, 4 queen). Castling is encoded as king captures own rook.
+//
+// Key is Polyglot's (Random64 table over figure x square, castling, en passant file, side to move),
+// so books built by other tools are usable and books built by buildBook are readable by them.
+namespace polyglot {
+
+enum class BookPick {
+    // Random move, chance proportional to entry weight
+    WEIGHTED,
+    // Move with highest weight
+    BEST
+};
+
+class Book {
+public:
+    // Throws if file is missing or is not array of entries
+    static std::unique_ptr<Book> load(const std::string& path);
+
+    Book(const Book&) = delete;
+    Book& operator=(const Book&) = delete;
+    ~Book();
+
+    // Book move of side to move c, nullopt if position is out of book
+    std::optional<Move> probe(const Board& b, Color c, BookPick pick = BookPick::WEIGHTED) const;
+
+    size_t size() const
+    {
+        return _entries;
+    }
+
+private:
+    void* _mapping = nullptr;
+    size_t _entries = 0u;
+
+    Book() = default;
+};
+
+uint64_t key(const Board& b, Color c);
+
+// Builds book from PGN file (.pgn) or text file with one game per line in coordinate notation
+// (e2e4 e7e5 ...), first plies of every game are counted and move weight is number of games playing it
+void buildBook(const std::string& gamesFile, const std::string& bookFile, size_t plies);
+
+} // namespace polyglot
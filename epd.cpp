@@ -0,0 +1,73 @@
+#include "epd.hpp"
+#include "ai.hpp"
+#include "board_stats.hpp"
+#include "fen.hpp"
+#include "thread_pool.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Jobs queued per worker, keeps memory bounded for huge files
+constexpr auto QUEUED_JOBS_PER_THREAD = 64u;
+
+std::string analysePosition(const std::string& line, const EpdConfig& config)
+{
+    auto position = parseFen(line);
+    BoardStats boardStats;
+    AI ai(position.board, position.color, boardStats);
+    ai.setMaxDepth(config.depth);
+
+    if (config.moveTime > 0u) {
+        ai.setDeadline(AI::Clock::now() + std::chrono::milliseconds(config.moveTime));
+    }
+    ai.run();
+
+    std::ostringstream os;
+    os << line << " acd " << ai.depth() << "; acn " << ai.nodes() << ";";
+    const auto move = ai.bestMove();
+    if (move) {
+        os << " ce " << *ai.bestScore() << "; bm " << *move << ";";
+    }
+    return os.str();
+}
+
+} // namespace
+
+void runEpd(const EpdConfig& config)
+{
+    std::ifstream file(config.file);
+    if (!file) {
+        throw std::runtime_error("EPD - unable to open " + config.file);
+    }
+
+    const auto threads = config.threads > 0u ? config.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    std::mutex outputMutex;
+    ThreadPool pool(threads, threads * QUEUED_JOBS_PER_THREAD);
+
+    for (std::string line; std::getline(file, line);) {
+        // Trailing whitespace including CR from CRLF files
+        line.erase(line.find_last_not_of(" \t\r") + 1u);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        pool.submit([line = std::move(line), &config, &outputMutex] {
+            std::string result;
+            try {
+                result = analysePosition(line, config);
+            } catch (const std::exception& ex) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << "EPD - skipping \"" << line << "\": " << ex.what() << std::endl;
+                return;
+            }
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << result << '\n';
+        });
+    }
+    pool.wait();
+    std::cout.flush();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct EpdConfig {
+    std::string file;
+    // Negascout depth, two = one ply
+    size_t depth = 4u;
+    // Zero means all cores
+    size_t threads = 0u;
+    // Time limit per position in milliseconds, zero means depth only
+    size_t moveTime = 0u;
+};
+
+// Streams EPD file and analyses each position on worker pool
+// Every input line is written to stdout as soon as it is analysed, followed by
+// acd (depth), acn (nodes), ce (score of side to move) and bm (best move in coordinate notation)
+// Output order follows completion, not input order
+void runEpd(const EpdConfig& config);
@@ -0,0 +1,149 @@
+#include "evaluation.hpp"
+#include "zobrist.hpp"
+
+#include <array>
+#include <bit>
+
+namespace {
+
+constexpr size_t PAWN_TABLE_SIZE = 1u << 14u;
+constexpr size_t EVAL_CACHE_SIZE = 1u << 14u;
+
+constexpr int DOUBLED_PAWN = -12;
+constexpr int ISOLATED_PAWN = -15;
+// Indexed by rank relative to pawn's color
+constexpr std::array<int, Board::HEIGHT> PASSED_PAWN = { 0, 5, 10, 20, 35, 60, 100, 0 };
+// Own pawn one or two ranks in front of king, on king's or neighbour file
+constexpr int SHELTER_NEAR = 12;
+constexpr int SHELTER_FAR = 6;
+
+constexpr uint64_t bit(int x, int y)
+{
+    return uint64_t { 1u } << (y * Board::WIDTH + x);
+}
+
+constexpr int relativeRank(Color c, int y)
+{
+    return c == Color::WHITE ? y : Board::HEIGHT - 1 - y;
+}
+
+int pawnStructure(const uint64_t ownPawns, const uint64_t enemyPawns, Color c)
+{
+    const auto dir = c == Color::WHITE ? 1 : -1;
+    int score = 0;
+    std::array<int, Board::WIDTH> fileCount {};
+
+    for (auto pawns = ownPawns; pawns != 0u; pawns &= pawns - 1u) {
+        fileCount[std::countr_zero(pawns) % Board::WIDTH]++;
+    }
+    for (const auto count : fileCount) {
+        if (count > 1) {
+            score += DOUBLED_PAWN * (count - 1);
+        }
+    }
+
+    for (auto pawns = ownPawns; pawns != 0u; pawns &= pawns - 1u) {
+        const auto pos = std::countr_zero(pawns);
+        const auto x = pos % Board::WIDTH;
+        const auto y = pos / Board::WIDTH;
+        const auto left = x > 0 ? fileCount[x - 1] : 0;
+        const auto right = x < Board::WIDTH - 1 ? fileCount[x + 1] : 0;
+        if (left == 0 && right == 0) {
+            score += ISOLATED_PAWN;
+        }
+        bool passed = true;
+        for (int ey = y + dir; passed && ey >= 0 && ey < Board::HEIGHT; ey += dir) {
+            for (int ex = x - 1; ex <= x + 1; ex++) {
+                if (Board::validIndex(ex, ey) && (enemyPawns & bit(ex, ey))) {
+                    passed = false;
+                }
+            }
+        }
+        if (passed) {
+            score += PASSED_PAWN[relativeRank(c, y)];
+        }
+    }
+    return score;
+}
+
+int kingShelter(const Board& b, uint64_t ownPawns, Color c)
+{
+    const auto king = b.kingPosition(c);
+    if (relativeRank(c, king.y) > 1) {
+        return 0;
+    }
+    const auto dir = c == Color::WHITE ? 1 : -1;
+    int score = 0;
+
+    for (int x = king.x - 1; x <= king.x + 1; x++) {
+        if (Board::validIndex(x, king.y + dir) && (ownPawns & bit(x, king.y + dir))) {
+            score += SHELTER_NEAR;
+        } else if (Board::validIndex(x, king.y + 2 * dir) && (ownPawns & bit(x, king.y + 2 * dir))) {
+            score += SHELTER_FAR;
+        }
+    }
+    return score;
+}
+
+} // namespace
+
+Evaluator::Evaluator()
+    : _pawnTable(PAWN_TABLE_SIZE)
+    , _evalCache(EVAL_CACHE_SIZE)
+{
+}
+
+int Evaluator::evaluate(const Board& b, Color c)
+{
+    if (b.kingCaptured()) {
+        return b.evaluate(c);
+    }
+    // Boards evaluated by different networks on one thread (self-play) must not share entries
+    const auto network = reinterpret_cast<uintptr_t>(b.network()) * 0x9E3779B97F4A7C15ull;
+    const auto key = b.hash() ^ (c == Color::BLACK ? zobrist::SIDE_KEY : 0u) ^ network;
+    auto& entry = _evalCache[key & (EVAL_CACHE_SIZE - 1u)];
+    if (entry.key != key) {
+        entry.key = key;
+        entry.score = evaluateFromScratch(b, c);
+    }
+    return entry.score;
+}
+
+Evaluator& Evaluator::threadLocal()
+{
+    thread_local Evaluator evaluator;
+    return evaluator;
+}
+
+const Evaluator::PawnEntry& Evaluator::probePawns(const Board& b)
+{
+    auto& entry = _pawnTable[b.pawnHash() & (PAWN_TABLE_SIZE - 1u)];
+    if (entry.key == b.pawnHash()) {
+        return entry;
+    }
+
+    entry.key = b.pawnHash();
+    for (const auto c : { Color::WHITE, Color::BLACK }) {
+        entry.pawns[static_cast<size_t>(c)] = b.squareMask(square(Figure::PAWN, c))
+            | b.squareMask(square(Figure::PAWN_IDLE, c))
+            | b.squareMask(square(Figure::PAWN_EN_PASSANT, c));
+    }
+    entry.score = pawnStructure(entry.pawns[0], entry.pawns[1], Color::WHITE)
+        - pawnStructure(entry.pawns[1], entry.pawns[0], Color::BLACK);
+
+    return entry;
+}
+
+int Evaluator::evaluateFromScratch(const Board& b, Color c)
+{
+    // Network is expected to know pawn structure on its own
+    if (b.network()) {
+        return b.evaluate(c);
+    }
+    const auto& pawns = probePawns(b);
+    const auto score = b.score() + pawns.score
+        + kingShelter(b, pawns.pawns[0], Color::WHITE)
+        - kingShelter(b, pawns.pawns[1], Color::BLACK);
+
+    return c == Color::WHITE ? score : -score;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Static evaluation on top of Board's PST (or NNUE) score
+// Pawn structure terms are cached in pawn hash table keyed on Board::pawnHash,
+// final scores are cached in evaluation cache keyed on Board::hash, side to move and network
+class Evaluator {
+public:
+    Evaluator();
+
+    // Score from c's point of view
+    int evaluate(const Board& b, Color c);
+
+    // Evaluator of calling thread, tables are kept between searches
+    static Evaluator& threadLocal();
+
+private:
+    struct PawnEntry {
+        uint64_t key = 0u;
+        // Indexed by color, bit = square position
+        uint64_t pawns[2] = { 0u, 0u };
+        // Doubled, isolated and passed pawns from white's point of view
+        int score = 0;
+    };
+
+    struct EvalEntry {
+        uint64_t key = 0u;
+        int score = 0;
+    };
+
+    std::vector<PawnEntry> _pawnTable;
+    std::vector<EvalEntry> _evalCache;
+
+    const PawnEntry& probePawns(const Board& b);
+    int evaluateFromScratch(const Board& b, Color c);
+};
@@ -0,0 +1,80 @@
+#include "extract.hpp"
+#include "fen.hpp"
+#include "pgn.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Output of thread is buffered and written at once
+constexpr size_t OUTPUT_BUFFER_SIZE = 1u << 20u;
+
+const char* resultLabel(float result)
+{
+    if (result > 0.75f) {
+        return " [1.0]\n";
+    }
+    if (result < 0.25f) {
+        return " [0.0]\n";
+    }
+    return " [0.5]\n";
+}
+
+} // namespace
+
+void runExtract(const ExtractConfig& config)
+{
+    const auto file = pgn::File::load(config.file);
+    const auto threads = config.threads > 0u ? config.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    const auto every = std::max<size_t>(config.every, 1u);
+
+    std::mutex outputMutex;
+    std::atomic<size_t> games = 0u;
+    std::atomic<size_t> positions = 0u;
+    std::vector<std::thread> workers;
+
+    for (const auto slice : file->split(threads)) {
+        workers.emplace_back([slice, &config, every, &outputMutex, &games, &positions] {
+            std::string buffer;
+            const auto flush = [&] {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << buffer;
+                buffer.clear();
+            };
+
+            pgn::forEachGame(slice, [&](const pgn::Game& game) {
+                const auto result = game.result();
+                if (result < 0.0f) {
+                    return;
+                }
+                games++;
+                try {
+                    pgn::replay(game, [&](const Board& b, Color c, const Move&, size_t ply) {
+                        if (ply >= config.skip && (ply - config.skip) % every == 0u) {
+                            buffer += toFen(b, c);
+                            buffer += resultLabel(result);
+                            positions++;
+                        }
+                        return true;
+                    });
+                } catch (const std::exception& ex) {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    std::cerr << "PGN - skipping game: " << ex.what() << std::endl;
+                }
+                if (buffer.size() >= OUTPUT_BUFFER_SIZE) {
+                    flush();
+                }
+            });
+            flush();
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    std::cout.flush();
+    std::cerr << "Games: " << games << ", positions: " << positions << std::endl;
+}
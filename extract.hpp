@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct ExtractConfig {
+    std::string file;
+    // Every n-th position of game is written
+    size_t every = 8u;
+    // Opening plies which are never written
+    size_t skip = 8u;
+    // Zero means all cores
+    size_t threads = 0u;
+};
+
+// Replays every game of PGN file and writes sampled positions to stdout as "<fen> [result]",
+// the format read by mce_tune. Games without result are skipped. File is split at game
+// boundaries between threads, output order follows completion
+void runExtract(const ExtractConfig& config);
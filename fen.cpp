@@ -0,0 +1,259 @@
+#include "fen.hpp"
+
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr int pawnStartRank(Color c)
+{
+    return c == Color::WHITE ? 1 : Board::HEIGHT - 2;
+}
+
+constexpr int backRank(Color c)
+{
+    return c == Color::WHITE ? 0 : Board::HEIGHT - 1;
+}
+
+Figure parseFigure(char ch)
+{
+    switch (std::tolower(ch)) {
+    case 'p':
+        return Figure::PAWN;
+    case 'n':
+        return Figure::KNIGHT;
+    case 'b':
+        return Figure::BISHOP;
+    case 'r':
+        return Figure::ROOK;
+    case 'q':
+        return Figure::QUEEN;
+    case 'k':
+        return Figure::KING;
+    default:
+        throw std::runtime_error(std::string("FEN - invalid figure ") + ch);
+    }
+}
+
+char figureChar(Figure f, Color c)
+{
+    char ch;
+    switch (f) {
+    case Figure::PAWN:
+    case Figure::PAWN_IDLE:
+    case Figure::PAWN_EN_PASSANT:
+        ch = 'p';
+        break;
+    case Figure::KNIGHT:
+        ch = 'n';
+        break;
+    case Figure::BISHOP:
+        ch = 'b';
+        break;
+    case Figure::ROOK:
+    case Figure::ROOK_IDLE:
+        ch = 'r';
+        break;
+    case Figure::QUEEN:
+        ch = 'q';
+        break;
+    default:
+        ch = 'k';
+        break;
+    }
+    return c == Color::WHITE ? std::toupper(ch) : ch;
+}
+
+void parsePlacement(Board::BoardType& squares, const std::string& placement)
+{
+    int x = 0;
+    int y = Board::HEIGHT - 1;
+
+    for (const auto ch : placement) {
+        if (ch == '/') {
+            if (x != Board::WIDTH) {
+                throw std::runtime_error("FEN - invalid rank length");
+            }
+            x = 0;
+            y--;
+            continue;
+        }
+        if (ch >= '1' && ch <= '8') {
+            x += ch - '0';
+            continue;
+        }
+        if (!Board::validIndex(x, y)) {
+            throw std::runtime_error("FEN - invalid placement");
+        }
+        const auto col = std::isupper(ch) ? Color::WHITE : Color::BLACK;
+        auto fig = parseFigure(ch);
+        if (fig == Figure::PAWN && y == pawnStartRank(col)) {
+            fig = Figure::PAWN_IDLE;
+        }
+        squares[y * Board::WIDTH + x] = square(fig, col);
+        x++;
+    }
+    if (x != Board::WIDTH || y != 0) {
+        throw std::runtime_error("FEN - invalid placement");
+    }
+}
+
+void parseCastling(Board::BoardType& squares, const std::string& castling)
+{
+    if (castling == "-") {
+        return;
+    }
+    for (const auto ch : castling) {
+        const auto col = std::isupper(ch) ? Color::WHITE : Color::BLACK;
+        const auto y = backRank(col);
+        const auto kingSide = std::tolower(ch) == 'k';
+        if (!kingSide && std::tolower(ch) != 'q') {
+            throw std::runtime_error(std::string("FEN - invalid castling ") + ch);
+        }
+        auto& kingSq = squares[y * Board::WIDTH + 4];
+        auto& rookSq = squares[y * Board::WIDTH + (kingSide ? Board::WIDTH - 1 : 0)];
+        if (kingSq != square(Figure::KING, col) && kingSq != square(Figure::KING_IDLE, col)) {
+            throw std::runtime_error("FEN - castling without king");
+        }
+        if (rookSq != square(Figure::ROOK, col)) {
+            throw std::runtime_error("FEN - castling without rook");
+        }
+        kingSq = square(Figure::KING_IDLE, col);
+        rookSq = square(Figure::ROOK_IDLE, col);
+    }
+}
+
+void parseEnPassant(Board::BoardType& squares, const std::string& enPassant, Color sideToMove)
+{
+    if (enPassant == "-") {
+        return;
+    }
+    if (enPassant.size() != 2u) {
+        throw std::runtime_error("FEN - invalid en passant square");
+    }
+    // Pawn which has just moved two squares belongs to the other side
+    const auto col = enemyColor(sideToMove);
+    const auto x = enPassant[0] - 'a';
+    const auto y = (enPassant[1] - '1') + (col == Color::WHITE ? 1 : -1);
+    if (!Board::validIndex(x, y)) {
+        throw std::runtime_error("FEN - invalid en passant square");
+    }
+    auto& sq = squares[y * Board::WIDTH + x];
+    if (sq != square(Figure::PAWN, col)) {
+        throw std::runtime_error("FEN - en passant square without pawn");
+    }
+    sq = square(Figure::PAWN_EN_PASSANT, col);
+}
+
+std::string castlingToFen(const Board& b)
+{
+    std::string castling;
+
+    for (const auto col : { Color::WHITE, Color::BLACK }) {
+        const auto y = backRank(col);
+        if (b.get(4, y) != square(Figure::KING_IDLE, col)) {
+            continue;
+        }
+        const auto ch = [col](char c) {
+            return col == Color::WHITE ? static_cast<char>(std::toupper(c)) : c;
+        };
+        if (b.get(Board::WIDTH - 1, y) == square(Figure::ROOK_IDLE, col)) {
+            castling += ch('k');
+        }
+        if (b.get(0, y) == square(Figure::ROOK_IDLE, col)) {
+            castling += ch('q');
+        }
+    }
+    return castling.empty() ? "-" : castling;
+}
+
+std::string enPassantToFen(const Board& b, Color sideToMove)
+{
+    // En passant pawn stays flagged until it moves again, report only one which can be captured
+    const auto col = enemyColor(sideToMove);
+    const auto y = col == Color::WHITE ? 3 : 4;
+
+    for (int x = 0; x < Board::WIDTH; x++) {
+        if (b.get(x, y) != square(Figure::PAWN_EN_PASSANT, col)) {
+            continue;
+        }
+        for (int i = -1; i <= 1; i += 2) {
+            if (!Board::validIndex(x + i, y)) {
+                continue;
+            }
+            const auto sq = b.get(x + i, y);
+            if (color(sq) == sideToMove && (figure(sq) == Figure::PAWN || figure(sq) == Figure::PAWN_EN_PASSANT)) {
+                const auto ty = y + (col == Color::WHITE ? -1 : 1);
+                return std::string { static_cast<char>(x + 'a'), static_cast<char>(ty + '1') };
+            }
+        }
+    }
+    return "-";
+}
+
+} // namespace
+
+Position parseFen(const std::string& fen)
+{
+    std::istringstream is(fen);
+    std::string placement, side, castling, enPassant;
+
+    if (!(is >> placement >> side >> castling >> enPassant)) {
+        throw std::runtime_error("FEN - missing fields");
+    }
+    if (side != "w" && side != "b") {
+        throw std::runtime_error("FEN - invalid side to move");
+    }
+    const auto col = side == "w" ? Color::WHITE : Color::BLACK;
+
+    Board::BoardType squares;
+    squares.fill(EMPTY_SQUARE);
+    parsePlacement(squares, placement);
+    parseCastling(squares, castling);
+    parseEnPassant(squares, enPassant, col);
+
+    Position position { Board(squares), col };
+
+    // Move counters are not present in EPD
+    size_t halfmoveClock, fullmoveNumber;
+    if (is >> halfmoveClock >> fullmoveNumber) {
+        position.halfmoveClock = halfmoveClock;
+        position.fullmoveNumber = fullmoveNumber;
+    }
+    return position;
+}
+
+std::string toFen(const Board& b, Color c, size_t halfmoveClock, size_t fullmoveNumber)
+{
+    std::ostringstream os;
+
+    for (int y = Board::HEIGHT - 1; y >= 0; y--) {
+        int empty = 0;
+        for (int x = 0; x < Board::WIDTH; x++) {
+            const auto sq = b.get(x, y);
+            if (figure(sq) == Figure::NONE) {
+                empty++;
+                continue;
+            }
+            if (empty > 0) {
+                os << empty;
+                empty = 0;
+            }
+            os << figureChar(figure(sq), color(sq));
+        }
+        if (empty > 0) {
+            os << empty;
+        }
+        if (y > 0) {
+            os << '/';
+        }
+    }
+
+    os << ' ' << (c == Color::WHITE ? 'w' : 'b');
+    os << ' ' << castlingToFen(b);
+    os << ' ' << enPassantToFen(b, c);
+    os << ' ' << halfmoveClock << ' ' << fullmoveNumber;
+
+    return os.str();
+}
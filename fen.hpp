@@ -0,0 +1,20 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <string>
+
+constexpr auto STARTING_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct Position {
+    Board board;
+    Color color = Color::WHITE;
+    size_t halfmoveClock = 0u;
+    size_t fullmoveNumber = 1u;
+};
+
+// Castling rights are mapped onto KING_IDLE/ROOK_IDLE, en passant square onto PAWN_EN_PASSANT
+// Pawns on their starting rank are PAWN_IDLE
+// Move counters are optional (EPD), throws on malformed input
+Position parseFen(const std::string& fen);
+std::string toFen(const Board& b, Color c, size_t halfmoveClock = 0u, size_t fullmoveNumber = 1u);
@@ -5,9 +5,9 @@
 
 namespace {
 
-#define MOVES_GENERATOR_ARGS Moves &moves, const Board &b, int x, int y
+#define MOVES_GENERATOR_ARGS MoveList &moves, const Board &b, int x, int y
 
-void moveInDirection(Moves& moves, const Board& b, Square toSq, int x, int y, int dx, int dy, size_t steps = Board::SIZE)
+void moveInDirection(MoveList& moves, const Board& b, Square toSq, int x, int y, int dx, int dy, size_t steps = Board::SIZE)
 {
     const auto fromSq = b.get(x, y);
     int mx = x + dx;
@@ -209,10 +209,15 @@ const std::array<MoveFunction, NUM_FIGURES> FIGURE_MOVES = {
 
 } // namespace
 
-Moves figureMoves(Figure f, const Board& b, int x, int y)
+void figureMoves(Figure f, const Board& b, int x, int y, MoveList& moves)
 {
-    Moves moves;
     FIGURE_MOVES[figureIndex(f)](moves, b, x, y);
+}
+
+MoveList figureMoves(Figure f, const Board& b, int x, int y)
+{
+    MoveList moves;
+    figureMoves(f, b, x, y, moves);
     return moves;
 }
 
@@ -2,5 +2,8 @@
 
 #include "board.hpp"
 
-Moves figureMoves(Figure f, const Board& b, int x, int y);
+// Appends moves of figure on x, y to list
+void figureMoves(Figure f, const Board& b, int x, int y, MoveList& moves);
+// Same on heap, for callers outside search
+MoveList figureMoves(Figure f, const Board& b, int x, int y);
 bool figureMoveValid(const Move& m, const Board& b, Color c);
\ No newline at end of file
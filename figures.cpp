@@ -146,6 +146,14 @@ int figureScore(Figure f, Color c, int pos)
     return (fscore + pstscore) * (c == Color::WHITE ? 1 : -1);
 }
 
+int figureValue(Figure f)
+{
+    if (f == Figure::NONE) {
+        return 0;
+    }
+    return FIGURE_SCORE[figureIndex(f)];
+}
+
 std::string figureSymbol(Figure f, Color c)
 {
     if (f == Figure::NONE) {
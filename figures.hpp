@@ -67,4 +67,6 @@ constexpr auto EMPTY_SQUARE = square(Figure::NONE, Color::WHITE);
 } // namespace
 
 int figureScore(Figure f, Color c, int pos);
+// Material value without PST, zero for NONE
+int figureValue(Figure f);
 std::string figureSymbol(Figure f, Color c);
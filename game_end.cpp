@@ -0,0 +1,132 @@
+#include "game_end.hpp"
+
+#include <cstdlib>
+
+bool castlingAllowed(const Board& b, Color c, const Move& m, bool inCheck)
+{
+    if (m.type != MoveType::CASTLING) {
+        return true;
+    }
+    // King passes square next to its origin
+    const auto dx = m.to.x > m.from.x ? 1 : -1;
+    return !inCheck && !b.attacked(m.from.x + dx, m.from.y, enemyColor(c));
+}
+
+bool mayExposeKing(const Board& b, Color c, const Move& m, bool inCheck)
+{
+    const auto f = figure(b.get(m.from.x, m.from.y));
+    if (inCheck || m.type == MoveType::EN_PASSANT || f == Figure::KING || f == Figure::KING_IDLE) {
+        return true;
+    }
+    const auto king = b.kingPosition(c);
+    const auto dx = m.from.x - king.x;
+    const auto dy = m.from.y - king.y;
+    return dx == 0 || dy == 0 || std::abs(dx) == std::abs(dy);
+}
+
+bool hasLegalMove(Board& b, Color c)
+{
+    const auto inCheck = b.kingInCheck(c);
+    for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
+        for (const auto& m : generator.movesChunk()) {
+            if (!castlingAllowed(b, c, m, inCheck)) {
+                continue;
+            }
+            if (!mayExposeKing(b, c, m, inCheck)) {
+                return true;
+            }
+            const auto undos = b.applyMove(m);
+            const auto check = b.kingInCheck(c);
+            b.undoMove(undos);
+            if (!check) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool insufficientMaterial(const Board& b)
+{
+    // Two kings and one more figure at most
+    if (b.figureCount() > 3) {
+        return false;
+    }
+    for (const auto sq : b.squares()) {
+        switch (figure(sq)) {
+        case Figure::NONE:
+        case Figure::KING:
+        case Figure::KING_IDLE:
+        case Figure::KNIGHT:
+        case Figure::BISHOP:
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+bool resetsHalfmoveClock(const Board& b, const Move& m)
+{
+    const auto f = figure(b.get(m.from.x, m.from.y));
+    return f == Figure::PAWN || f == Figure::PAWN_IDLE || f == Figure::PAWN_EN_PASSANT || b.isCapture(m);
+}
+
+int scoreToTt(int score, size_t ply)
+{
+    if (score >= MATE_BOUND && score <= MATE_SCORE) {
+        return score + static_cast<int>(ply);
+    }
+    if (score <= -MATE_BOUND && score >= -MATE_SCORE) {
+        return score - static_cast<int>(ply);
+    }
+    return score;
+}
+
+int scoreFromTt(int score, size_t ply)
+{
+    if (score >= MATE_BOUND && score <= MATE_SCORE) {
+        return score - static_cast<int>(ply);
+    }
+    if (score <= -MATE_BOUND && score >= -MATE_SCORE) {
+        return score + static_cast<int>(ply);
+    }
+    return score;
+}
+
+GameEnd gameEnd(Board& b, Color c, const BoardStats& boardStats, size_t halfmoveClock)
+{
+    // Mate takes precedence over draws by rule
+    if (!hasLegalMove(b, c)) {
+        return b.kingInCheck(c) ? GameEnd::CHECKMATE : GameEnd::STALEMATE;
+    }
+    if (insufficientMaterial(b)) {
+        return GameEnd::INSUFFICIENT_MATERIAL;
+    }
+    if (boardStats.visits(b) >= 3u) {
+        return GameEnd::THREEFOLD_REPETITION;
+    }
+    if (halfmoveClock >= FIFTY_MOVE_PLIES) {
+        return GameEnd::FIFTY_MOVES;
+    }
+    return GameEnd::NONE;
+}
+
+const char* toString(GameEnd end)
+{
+    switch (end) {
+    case GameEnd::CHECKMATE:
+        return "checkmate";
+    case GameEnd::STALEMATE:
+        return "stalemate";
+    case GameEnd::INSUFFICIENT_MATERIAL:
+        return "insufficient material";
+    case GameEnd::THREEFOLD_REPETITION:
+        return "threefold repetition";
+    case GameEnd::FIFTY_MOVES:
+        return "fifty move rule";
+    default:
+        return "none";
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "board.hpp"
+#include "board_stats.hpp"
+
+#include <cstddef>
+
+// Game termination by rules, shared by CLI game, self-play and search
+enum class GameEnd {
+    NONE,
+    CHECKMATE,
+    STALEMATE,
+    INSUFFICIENT_MATERIAL,
+    THREEFOLD_REPETITION,
+    FIFTY_MOVES
+};
+
+// Plies without capture or pawn move ending the game
+constexpr size_t FIFTY_MOVE_PLIES = 100u;
+// Score of checkmated side to move, plies from root are subtracted so shorter mates are preferred
+// It stays above tablebase wins and below king capture
+constexpr int MATE_SCORE = 65000;
+// Scores at least this far from zero up to MATE_SCORE are mates or tablebase results, they depend on plies from root
+constexpr int MATE_BOUND = 50000;
+
+// Castling out of or through check is not allowed, true for other moves
+// Rest of legality (own king not attacked) is known once move is applied
+bool castlingAllowed(const Board& b, Color c, const Move& m, bool inCheck);
+// Own king can be left attacked only in check, by king move, en passant or by figure on line with king (pin)
+// Other pseudo-legal moves need no check test
+bool mayExposeKing(const Board& b, Color c, const Move& m, bool inCheck);
+// Stops at first legal move
+bool hasLegalMove(Board& b, Color c);
+// Bare kings or single minor figure
+bool insufficientMaterial(const Board& b);
+// Capture or pawn move
+bool resetsHalfmoveClock(const Board& b, const Move& m);
+
+// Transposition table keeps mate scores relative to the stored node, so they hold at any ply and in later searches
+int scoreToTt(int score, size_t ply);
+int scoreFromTt(int score, size_t ply);
+
+// Termination of position with side to move c, boardStats must already contain the position
+// Costs one check test and legal move generation up to first legal move
+GameEnd gameEnd(Board& b, Color c, const BoardStats& boardStats, size_t halfmoveClock);
+const char* toString(GameEnd end);
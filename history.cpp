@@ -0,0 +1,47 @@
+#include "history.hpp"
+
+#include <memory>
+
+void SearchHistory::clear()
+{
+    _butterfly.fill(0);
+    _counterMoves.fill(0u);
+    _continuation.fill(0);
+}
+
+uint16_t SearchHistory::pieceTo(Square sq, const Point& to)
+{
+    size_t kind;
+    switch (figure(sq)) {
+    case Figure::PAWN:
+    case Figure::PAWN_IDLE:
+    case Figure::PAWN_EN_PASSANT:
+        kind = 0u;
+        break;
+    case Figure::KNIGHT:
+        kind = 1u;
+        break;
+    case Figure::BISHOP:
+        kind = 2u;
+        break;
+    case Figure::ROOK:
+    case Figure::ROOK_IDLE:
+        kind = 3u;
+        break;
+    case Figure::QUEEN:
+        kind = 4u;
+        break;
+    default:
+        kind = 5u;
+        break;
+    }
+    const auto piece = kind + (color(sq) == Color::WHITE ? 0u : PIECES / 2u);
+    return static_cast<uint16_t>(piece * 64u + to.y * Board::WIDTH + to.x);
+}
+
+SearchHistory& SearchHistory::threadLocal()
+{
+    // Tables take few MB, they are kept on heap instead of thread's static storage
+    thread_local std::unique_ptr<SearchHistory> history = std::make_unique<SearchHistory>();
+    return *history;
+}
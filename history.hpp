@@ -0,0 +1,58 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+// Quiet move ordering statistics of one search thread
+// Butterfly history is indexed by side and packed move (from, to), counter moves by packed previous move
+// and continuation histories by (piece, to) of move one or two plies back and (piece, to) of current move
+// Every table is one contiguous cache line aligned array
+class SearchHistory {
+public:
+    // Kind of figure (pawn, knight, bishop, rook, queen, king) per color
+    static constexpr size_t PIECES = 12u;
+    static constexpr size_t PIECE_TO = PIECES * 64u;
+    static constexpr size_t PACKED_MOVES = 64u * 64u;
+    // Entries converge to this bound under gravity updates
+    static constexpr int MAX_SCORE = 16384;
+    // Continuation of previous move (1) and of own previous move (2)
+    static constexpr size_t CONTINUATION_PLIES = 2u;
+
+    void clear();
+
+    int16_t& butterfly(Color c, uint16_t move)
+    {
+        return _butterfly[static_cast<size_t>(c == Color::WHITE ? 0u : 1u) * PACKED_MOVES + move];
+    }
+
+    uint16_t& counterMove(uint16_t previousMove)
+    {
+        return _counterMoves[previousMove];
+    }
+
+    // Row of continuation history plies back, indexed by (piece, to) of current move
+    int16_t* continuation(size_t plies, uint16_t previousPieceTo)
+    {
+        return &_continuation[((plies - 1u) * PIECE_TO + previousPieceTo) * PIECE_TO];
+    }
+
+    // Bonus (positive) or malus (negative), entry moves towards bound proportionally to distance from it
+    static void update(int16_t& entry, int bonus)
+    {
+        entry = static_cast<int16_t>(entry + bonus - entry * std::abs(bonus) / MAX_SCORE);
+    }
+
+    // Index of figure moving onto square to
+    static uint16_t pieceTo(Square sq, const Point& to);
+
+    // History of calling thread, allocated on first use
+    static SearchHistory& threadLocal();
+
+private:
+    alignas(64) std::array<int16_t, 2u * PACKED_MOVES> _butterfly {};
+    alignas(64) std::array<uint16_t, PACKED_MOVES> _counterMoves {};
+    alignas(64) std::array<int16_t, CONTINUATION_PLIES * PIECE_TO * PIECE_TO> _continuation {};
+};
@@ -1,15 +1,33 @@
 
 #include "ai.hpp"
+#include "bench.hpp"
+#include "book.hpp"
+#include "epd.hpp"
+#include "extract.hpp"
+#include "fen.hpp"
+#include "game_end.hpp"
+#include "search_trace.hpp"
+#include "server.hpp"
+#include "tablebase.hpp"
+#include "tt.hpp"
 #include "board.hpp"
 #include "board_stats.hpp"
 #include "figure_moves.hpp"
-#include "timer.hpp"
 
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
 
 namespace {
 
 constexpr auto COMPUTER_PLAY_TIME = 2000u;
+constexpr auto BOOK_PLIES = 16u;
+
+// Opening book of computer player, nullptr if no book is used
+const polyglot::Book* book = nullptr;
+// Plies since last capture or pawn move of CLI game
+size_t halfmoveClock = 0u;
 
 inline bool pointValid(const Point& p)
 {
@@ -74,6 +92,14 @@ std::optional<Move> parseMove(const std::string& str, const Board& board)
     return Move { from, to, square(resultFigure, col), moveType };
 }
 
+void play(Board& board, BoardStats& boardStats, const Move& m)
+{
+    halfmoveClock = resetsHalfmoveClock(board, m) ? 0u : halfmoveClock + 1u;
+    board.applyMove(m);
+    board.clearUndoMoves();
+    boardStats.visit(board);
+}
+
 void playerPlays(Board& board, BoardStats& boardStats, Color col)
 {
     while (true) {
@@ -86,106 +112,240 @@ void playerPlays(Board& board, BoardStats& boardStats, Color col)
             continue;
         }
 
-        board.applyMove(*m);
-        boardStats.visit(board);
+        play(board, boardStats, *m);
         break;
     }
 }
 
-Move computerPlays(Board& board, BoardStats& boardStats, Color col)
+void computerPlays(Board& board, BoardStats& boardStats, Color col)
 {
-    AI ai(board, col, boardStats);
-    Timer timer(COMPUTER_PLAY_TIME, [&] {
-        ai.stop();
-    });
+    if (const auto m = book ? book->probe(board, col) : std::nullopt) {
+        play(board, boardStats, *m);
+
+        std::cout << "Book move: " << *m << std::endl;
+        std::cout << std::endl;
+        return;
+    }
 
+    AI ai(board, col, boardStats);
+    ai.setStatsOutput(&std::cerr);
+    ai.setInfoOutput(&std::cerr);
+    ai.setDeadline(AI::Clock::now() + std::chrono::milliseconds(COMPUTER_PLAY_TIME));
     ai.run();
-    timer.stop();
-    // Wait for AI to finish
-    timer.join();
 
     const auto m = ai.bestMove();
     if (!m) {
         throw std::runtime_error("Computer - no move available");
     }
-    board.applyMove(*m);
-    board.clearUndoMoves();
-    boardStats.visit(board);
+    play(board, boardStats, *m);
 
     std::cout << "Score: " << board.score() << std::endl;
     std::cout << "My move: " << *m << std::endl;
     std::cout << std::endl;
 }
 
-enum class GameStatus {
-    CONTINUE,
-    DRAW,
-    WIN_LOSS
-};
-
-template <typename Fn>
-void forEachMove(Board& b, Color c, Fn&& f)
+// Side to move loses once its king is captured (move leaving king in check was played) or it is checkmated
+bool resolveGameEnd(Board& board, BoardStats& boardStats, Color col, bool computerTurn)
 {
-    for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
-        for (const auto& m : generator.movesChunk()) {
-            const auto undos = b.applyMove(m);
-            f(m);
-            b.undoMove(undos);
-        }
+    const auto end = board.kingCaptured() ? GameEnd::CHECKMATE : gameEnd(board, col, boardStats, halfmoveClock);
+    if (end == GameEnd::NONE) {
+        return false;
+    }
+    if (end == GameEnd::CHECKMATE) {
+        std::cout << (computerTurn ? "You have won!" : "You have lost!") << std::endl;
+    } else {
+        std::cout << "Draw by " << toString(end) << "!" << std::endl;
     }
+    return true;
 }
 
-GameStatus gameStatus(Board& board, Color col)
+int bench(int argc, char** argv)
 {
-    if (board.kingCaptured()) {
-        return GameStatus::WIN_LOSS;
+    // mce bench [depth] [threads] [hash] [statsfile]
+    BenchConfig config;
+    if (argc > 2) {
+        config.depth = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        config.threads = std::stoul(argv[3]);
+    }
+    if (argc > 4) {
+        config.hash = std::stoul(argv[4]);
     }
-    const auto ecol = enemyColor(col);
-    bool draw = true;
+    if (argc > 5) {
+        config.statsFile = argv[5];
+    }
+    runBench(config);
+    return 0;
+}
 
-    forEachMove(board, col, [&](const auto&) {
-        if (!draw || board.kingCaptured()) {
-            return;
-        }
-        bool kingAlive = true;
-        forEachMove(board, ecol, [&](const auto&) {
-            kingAlive = kingAlive && !board.kingCaptured();
-        });
-        if (kingAlive) {
-            draw = false;
-        }
-    });
+int epd(int argc, char** argv)
+{
+    // mce epd <file> [depth] [threads] [movetime]
+    if (argc < 3) {
+        throw std::runtime_error("usage: mce epd <file> [depth] [threads] [movetime]");
+    }
+    EpdConfig config;
+    config.file = argv[2];
+    if (argc > 3) {
+        config.depth = std::stoul(argv[3]);
+    }
+    if (argc > 4) {
+        config.threads = std::stoul(argv[4]);
+    }
+    if (argc > 5) {
+        config.moveTime = std::stoul(argv[5]);
+    }
+    runEpd(config);
+    return 0;
+}
 
-    if (draw) {
-        return GameStatus::DRAW;
+int server(int argc, char** argv)
+{
+    // mce server [threads] [movetime]
+    ServerConfig config;
+    if (argc > 2) {
+        config.threads = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        config.moveTime = std::stoul(argv[3]);
     }
+    runServer(config);
+    return 0;
+}
 
-    return GameStatus::CONTINUE;
+int extract(int argc, char** argv)
+{
+    // mce extract <pgn> [every] [skip] [threads]
+    if (argc < 3) {
+        throw std::runtime_error("usage: mce extract <pgn> [every] [skip] [threads]");
+    }
+    ExtractConfig config;
+    config.file = argv[2];
+    if (argc > 3) {
+        config.every = std::stoul(argv[3]);
+    }
+    if (argc > 4) {
+        config.skip = std::stoul(argv[4]);
+    }
+    if (argc > 5) {
+        config.threads = std::stoul(argv[5]);
+    }
+    runExtract(config);
+    return 0;
 }
 
-bool resolveGameStatus(Board& board, Color col, bool computerTurn, GameStatus status)
+int analyze(int argc, char** argv)
 {
-    if (status == GameStatus::WIN_LOSS) {
-        if (computerTurn) {
-            std::cout << "You have lost!" << std::endl;
-        } else {
-            std::cout << "You have won!" << std::endl;
-        }
-        return true;
+    // mce analyze <fen> [depth] [multipv] [hashfile]
+    if (argc < 3) {
+        throw std::runtime_error("usage: mce analyze <fen> [depth] [multipv] [hashfile]");
     }
-    if (status == GameStatus::DRAW) {
-        std::cout << "Draw!" << std::endl;
-        return true;
+    // Table saved by previous session is loaded, so search resumes warm
+    const std::string hashFile = argc > 5 ? argv[5] : "";
+    auto& table = TranspositionTable::threadLocal();
+    if (!hashFile.empty() && std::ifstream(hashFile).good()) {
+        table.load(hashFile);
+        TranspositionTable::setDefaultSize(table.sizeMb());
     }
-    return false;
+
+    auto position = parseFen(argv[2]);
+    BoardStats boardStats;
+    AI ai(position.board, position.color, boardStats);
+    ai.setInfoOutput(&std::cout);
+    if (argc > 3) {
+        ai.setMaxDepth(std::stoul(argv[3]));
+    }
+    if (argc > 4) {
+        ai.setMultiPv(std::stoul(argv[4]));
+    }
+    ai.run();
+
+    if (!hashFile.empty()) {
+        table.save(hashFile);
+    }
+    return 0;
+}
+
+int buildBook(int argc, char** argv)
+{
+    // mce book <games> <out.bin> [plies]
+    if (argc < 4) {
+        throw std::runtime_error("usage: mce book <games> <out.bin> [plies]");
+    }
+    const auto plies = argc > 4 ? std::stoul(argv[4]) : BOOK_PLIES;
+    polyglot::buildBook(argv[2], argv[3], plies);
+    return 0;
 }
 
 } // namespace
 
-int main()
+int main(int argc, char** argv)
 {
+    // mce [--nnue <file>] [--book <file>] [--tb <dir>] [--hash <MB>] [--trace <file>] [mode args...]
+    std::unique_ptr<nnue::Network> network;
+    std::unique_ptr<polyglot::Book> openingBook;
+    std::unique_ptr<tablebase::Tablebases> tablebases;
+    // Outlives every search, remaining records are written when it is destroyed
+    std::unique_ptr<SearchTrace> trace;
+    while (argc > 2 && (std::string(argv[1]) == "--nnue" || std::string(argv[1]) == "--book" || std::string(argv[1]) == "--tb" || std::string(argv[1]) == "--hash" || std::string(argv[1]) == "--trace")) {
+        try {
+            const std::string option = argv[1];
+            if (option == "--nnue") {
+                network = nnue::Network::load(argv[2]);
+                nnue::setDefaultNetwork(network.get());
+            } else if (option == "--book") {
+                openingBook = polyglot::Book::load(argv[2]);
+                book = openingBook.get();
+            } else if (option == "--hash") {
+                TranspositionTable::setDefaultSize(std::stoul(argv[2]));
+            } else if (option == "--trace") {
+                trace = std::make_unique<SearchTrace>(argv[2]);
+                setDefaultTrace(trace.get());
+            } else {
+                tablebases = tablebase::Tablebases::load(argv[2]);
+                tablebase::setDefaultTablebases(tablebases.get());
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "FATAL: " << ex.what() << std::endl;
+            return -1;
+        }
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    if (argc > 1) {
+        const std::string mode = argv[1];
+        try {
+            if (mode == "bench") {
+                return bench(argc, argv);
+            }
+            if (mode == "epd") {
+                return epd(argc, argv);
+            }
+            if (mode == "server") {
+                return server(argc, argv);
+            }
+            if (mode == "extract") {
+                return extract(argc, argv);
+            }
+            if (mode == "analyze") {
+                return analyze(argc, argv);
+            }
+            if (mode == "book") {
+                return buildBook(argc, argv);
+            }
+            throw std::runtime_error("unknown mode " + mode);
+        } catch (const std::exception& ex) {
+            std::cerr << "FATAL: " << ex.what() << std::endl;
+            return -1;
+        }
+    }
+
     Board board;
     BoardStats boardStats;
+    boardStats.visit(board);
 
     auto color = Color::WHITE;
     bool computerTurn = true;
@@ -194,8 +354,7 @@ int main()
         try {
             std::cout << board;
 
-            const auto status = gameStatus(board, color);
-            if (resolveGameStatus(board, color, computerTurn, status)) {
+            if (resolveGameEnd(board, boardStats, color, computerTurn)) {
                 break;
             }
 
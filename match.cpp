@@ -0,0 +1,443 @@
+#include "ai.hpp"
+#include "board_stats.hpp"
+#include "book.hpp"
+#include "fen.hpp"
+#include "game_end.hpp"
+#include "nnue.hpp"
+#include "notation.hpp"
+#include "tablebase.hpp"
+#include "tt.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+constexpr size_t DEFAULT_GAMES = 1000u;
+constexpr size_t DEFAULT_MOVE_TIME = 50u;
+constexpr size_t BOOK_PLIES = 8u;
+constexpr size_t MAX_PLIES = 400u;
+// Win is adjudicated once both engines agree on score for this many consecutive plies
+constexpr int WIN_SCORE = 1000;
+constexpr size_t WIN_PLIES = 6u;
+// Draw is adjudicated after DRAW_MIN_PLY if score stays near zero
+constexpr int DRAW_SCORE = 10;
+constexpr size_t DRAW_PLIES = 16u;
+constexpr size_t DRAW_MIN_PLY = 80u;
+constexpr size_t PGN_LINE_WIDTH = 80u;
+
+struct Player {
+    std::string name;
+    std::unique_ptr<nnue::Network> ownNetwork;
+    std::unique_ptr<tablebase::Tablebases> ownTablebases;
+    const nnue::Network* network = nnue::defaultNetwork();
+    const tablebase::Tablebases* tablebases = tablebase::defaultTablebases();
+    size_t moveTime = DEFAULT_MOVE_TIME;
+    // 0 for no depth limit
+    size_t depth = 0u;
+    PruningMargins margins;
+};
+
+struct GameRecord {
+    // 1 white wins, 0.5 draw, 0 black wins, negative if game was aborted
+    float result = -1.0f;
+    std::string termination;
+    std::vector<std::string> moves;
+};
+
+// Sequential probability ratio test of H0: elo = elo0 against H1: elo = elo1
+// Log likelihood ratio uses normal approximation of trinomial (win, draw, loss) distribution
+struct Sprt {
+    double elo0 = 0.0;
+    double elo1 = 10.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+
+    double lowerBound() const
+    {
+        return std::log(beta / (1.0 - alpha));
+    }
+
+    double upperBound() const
+    {
+        return std::log((1.0 - beta) / alpha);
+    }
+
+    double llr(size_t wins, size_t draws, size_t losses) const
+    {
+        const auto n = static_cast<double>(wins + draws + losses);
+        const auto s = (wins + draws * 0.5) / n;
+        const auto variance = (wins * (1.0 - s) * (1.0 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / n;
+        // Every game ended the same way (or there is none, variance is NaN then), score tells nothing yet
+        if (!(variance > 0.0)) {
+            return 0.0;
+        }
+        const auto s0 = expectedScore(elo0);
+        const auto s1 = expectedScore(elo1);
+        return n * (s1 - s0) * (2.0 * s - s0 - s1) / (2.0 * variance);
+    }
+
+    static double expectedScore(double elo)
+    {
+        return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+    }
+};
+
+double eloFromScore(double s)
+{
+    s = std::clamp(s, 1e-6, 1.0 - 1e-6);
+    return -400.0 * std::log10(1.0 / s - 1.0);
+}
+
+// Elo difference with 95% confidence margin
+std::pair<double, double> eloEstimate(size_t wins, size_t draws, size_t losses)
+{
+    const auto n = static_cast<double>(wins + draws + losses);
+    const auto s = (wins + draws * 0.5) / n;
+    const auto variance = (wins * (1.0 - s) * (1.0 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / n;
+    const auto margin = 1.96 * std::sqrt(variance / n);
+    return { eloFromScore(s), (eloFromScore(s + margin) - eloFromScore(s - margin)) / 2.0 };
+}
+
+float lossOf(Color c)
+{
+    return c == Color::WHITE ? 0.0f : 1.0f;
+}
+
+// Players keep their own transposition tables, indexed by color, scores of different configurations must not mix
+GameRecord playGame(const std::string& fen, const Player& white, const Player& black, TranspositionTable (&tables)[2], const std::atomic_bool& stop)
+{
+    for (auto& table : tables) {
+        table.clear();
+    }
+    auto position = parseFen(fen);
+    auto& board = position.board;
+    auto color = position.color;
+    auto halfmoveClock = position.halfmoveClock;
+    BoardStats boardStats;
+    boardStats.visit(board);
+
+    GameRecord record;
+    size_t winPlies = 0u, drawPlies = 0u;
+    int lastWhiteScore = 0;
+
+    for (size_t ply = 0u; !stop; ply++) {
+        if (const auto end = gameEnd(board, color, boardStats, halfmoveClock); end != GameEnd::NONE) {
+            record.result = end == GameEnd::CHECKMATE ? lossOf(color) : 0.5f;
+            record.termination = toString(end);
+            return record;
+        }
+        if (ply >= MAX_PLIES) {
+            record.result = 0.5f;
+            record.termination = "move limit";
+            return record;
+        }
+
+        const auto& player = color == Color::WHITE ? white : black;
+        if (board.network() != player.network) {
+            board.setNetwork(player.network);
+        }
+        AI ai(board, color, boardStats);
+        ai.setTablebases(player.tablebases);
+        ai.setPruningMargins(player.margins);
+        ai.setTranspositionTable(&tables[color == Color::WHITE ? 0 : 1]);
+        ai.setDeadline(AI::Clock::now() + std::chrono::milliseconds(player.moveTime));
+        if (player.depth > 0u) {
+            ai.setMaxDepth(player.depth);
+        }
+        ai.run();
+
+        const auto m = ai.bestMove();
+        bool legal = false;
+        if (m && castlingAllowed(board, color, *m, board.kingInCheck(color))) {
+            const auto undos = board.applyMove(*m);
+            legal = !board.kingInCheck(color);
+            board.undoMove(undos);
+        }
+        if (!legal) {
+            record.result = lossOf(color);
+            record.termination = "illegal move";
+            return record;
+        }
+
+        // Adjudication by scores of both engines, score is converted to white's point of view
+        const auto whiteScore = color == Color::WHITE ? *ai.bestScore() : -*ai.bestScore();
+        const bool winning = std::abs(whiteScore) >= WIN_SCORE && (winPlies == 0u || (whiteScore > 0) == (lastWhiteScore > 0));
+        winPlies = winning ? winPlies + 1u : 0u;
+        drawPlies = std::abs(whiteScore) <= DRAW_SCORE ? drawPlies + 1u : 0u;
+        lastWhiteScore = whiteScore;
+
+        halfmoveClock = resetsHalfmoveClock(board, *m) ? 0u : halfmoveClock + 1u;
+        record.moves.push_back(toSan(board, color, *m));
+        board.applyMove(*m);
+        board.clearUndoMoves();
+        color = enemyColor(color);
+        boardStats.visit(board);
+
+        if (winPlies >= WIN_PLIES) {
+            record.result = whiteScore > 0 ? 1.0f : 0.0f;
+            record.termination = "adjudication";
+            return record;
+        }
+        if (drawPlies >= DRAW_PLIES && ply >= DRAW_MIN_PLY) {
+            record.result = 0.5f;
+            record.termination = "adjudication";
+            return record;
+        }
+    }
+    return record;
+}
+
+std::string resultString(float result)
+{
+    if (result > 0.75f) {
+        return "1-0";
+    }
+    if (result < 0.25f) {
+        return "0-1";
+    }
+    return "1/2-1/2";
+}
+
+std::string toPgn(const GameRecord& record, const std::string& fen, size_t round, const Player& white, const Player& black)
+{
+    const auto position = parseFen(fen);
+    const auto result = resultString(record.result);
+    std::ostringstream os;
+
+    os << "[Event \"mce_match\"]\n";
+    os << "[Round \"" << round << "\"]\n";
+    os << "[White \"" << white.name << "\"]\n";
+    os << "[Black \"" << black.name << "\"]\n";
+    os << "[Result \"" << result << "\"]\n";
+    if (fen != STARTING_FEN) {
+        os << "[SetUp \"1\"]\n";
+        os << "[FEN \"" << fen << "\"]\n";
+    }
+    os << "[Termination \"" << record.termination << "\"]\n\n";
+
+    std::string line;
+    const auto append = [&](const std::string& token) {
+        if (!line.empty() && line.size() + token.size() + 1u > PGN_LINE_WIDTH) {
+            os << line << '\n';
+            line.clear();
+        }
+        line += line.empty() ? token : " " + token;
+    };
+    auto moveNumber = position.fullmoveNumber;
+    auto color = position.color;
+    for (size_t i = 0u; i < record.moves.size(); i++) {
+        if (color == Color::WHITE) {
+            append(std::to_string(moveNumber) + ".");
+        } else if (i == 0u) {
+            append(std::to_string(moveNumber) + "...");
+        }
+        append(record.moves[i]);
+        moveNumber += color == Color::BLACK;
+        color = enemyColor(color);
+    }
+    append(result);
+    os << line << "\n\n";
+    return os.str();
+}
+
+// Opening positions as FEN, either EPD lines or random walks of opening book
+std::vector<std::string> loadOpenings(const std::string& path, size_t count)
+{
+    std::vector<std::string> openings;
+    if (path == "-") {
+        openings.emplace_back(STARTING_FEN);
+    } else if (path.size() > 4u && path.compare(path.size() - 4u, 4u, ".bin") == 0) {
+        const auto book = polyglot::Book::load(path);
+        for (size_t i = 0u; i < count; i++) {
+            Board board;
+            auto color = Color::WHITE;
+            size_t ply = 0u;
+            for (; ply < BOOK_PLIES; ply++) {
+                const auto m = book->probe(board, color);
+                if (!m) {
+                    break;
+                }
+                board.applyMove(*m);
+                board.clearUndoMoves();
+                color = enemyColor(color);
+            }
+            openings.push_back(toFen(board, color, 0u, ply / 2u + 1u));
+        }
+    } else {
+        std::ifstream is(path);
+        if (!is) {
+            throw std::runtime_error("Match - unable to open " + path);
+        }
+        for (std::string line; std::getline(is, line);) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            // Validated and normalized, EPD operations are dropped
+            const auto position = parseFen(line);
+            openings.push_back(toFen(position.board, position.color, position.halfmoveClock, position.fullmoveNumber));
+        }
+    }
+    if (openings.empty()) {
+        throw std::runtime_error("Match - no openings in " + path);
+    }
+    return openings;
+}
+
+void configurePlayer(Player& player, const std::string& option, const std::string& value)
+{
+    if (option == "nnue") {
+        player.ownNetwork = nnue::Network::load(value);
+        player.network = player.ownNetwork.get();
+    } else if (option == "tb") {
+        player.ownTablebases = tablebase::Tablebases::load(value);
+        player.tablebases = player.ownTablebases.get();
+    } else if (option == "time") {
+        player.moveTime = std::stoul(value);
+    } else if (option == "depth") {
+        player.depth = std::stoul(value);
+    } else if (option == "margins") {
+        // Reverse futility, futility and razoring margins of depths 1 to 3, comma separated
+        std::istringstream is(value);
+        for (auto* margins : { &player.margins.reverseFutility, &player.margins.futility, &player.margins.razoring }) {
+            for (size_t depth = 1u; depth <= PruningMargins::FRONTIER_DEPTH; depth++) {
+                std::string margin;
+                if (!std::getline(is, margin, ',')) {
+                    throw std::runtime_error("Match - margins need 9 values: " + value);
+                }
+                (*margins)[depth] = std::stoi(margin);
+            }
+        }
+    } else if (option == "name") {
+        player.name = value;
+    } else {
+        throw std::runtime_error("Match - unknown option --" + option);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // mce_match <openings> [games] [threads] [pgn] [--<option>{1,2} <value>...] [--elo0 e] [--elo1 e]
+    //   player options: name, nnue <file>, tb <dir>, time <ms>, depth <plies>, margins <9 comma separated values>
+    if (argc < 2) {
+        std::cerr << "usage: mce_match <openings.epd|book.bin|-> [games] [threads] [pgn] "
+                     "[--{name,nnue,tb,time,depth,margins}{1,2} <value>] [--elo0 <elo>] [--elo1 <elo>]"
+                  << std::endl;
+        return -1;
+    }
+    try {
+        Player players[2];
+        players[0].name = "mce-1";
+        players[1].name = "mce-2";
+        Sprt sprt;
+        std::vector<std::string> args;
+
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg.compare(0u, 2u, "--") != 0) {
+                args.push_back(arg);
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Match - missing value of " + arg);
+            }
+            const std::string value = argv[++i];
+            if (arg == "--elo0") {
+                sprt.elo0 = std::stod(value);
+            } else if (arg == "--elo1") {
+                sprt.elo1 = std::stod(value);
+            } else if (arg.back() == '1' || arg.back() == '2') {
+                configurePlayer(players[arg.back() - '1'], arg.substr(2u, arg.size() - 3u), value);
+            } else {
+                throw std::runtime_error("Match - unknown option " + arg);
+            }
+        }
+
+        const auto games = args.size() > 1u ? std::stoul(args[1]) : DEFAULT_GAMES;
+        const auto threads = args.size() > 2u ? std::stoul(args[2]) : 0u;
+        const auto numThreads = threads > 0u ? threads : std::max(1u, std::thread::hardware_concurrency());
+        // Every opening is played twice with colors swapped
+        const auto openings = loadOpenings(args[0], (games + 1u) / 2u);
+
+        std::ofstream pgnFile;
+        if (args.size() > 3u) {
+            pgnFile.open(args[3]);
+            if (!pgnFile) {
+                throw std::runtime_error("Match - unable to create " + args[3]);
+            }
+        }
+
+        std::mutex resultMutex;
+        std::atomic<size_t> nextGame = 0u;
+        std::atomic_bool stop = false;
+        // Results from the first player's point of view
+        size_t wins = 0u, draws = 0u, losses = 0u;
+        std::map<std::string, size_t> terminations;
+        std::vector<std::thread> workers;
+
+        for (size_t t = 0u; t < numThreads; t++) {
+            workers.emplace_back([&] {
+                TranspositionTable tables[2];
+                for (auto game = nextGame++; game < games && !stop; game = nextGame++) {
+                    const auto& fen = openings[(game / 2u) % openings.size()];
+                    const auto swapped = game % 2u == 1u;
+                    const auto& white = players[swapped ? 1 : 0];
+                    const auto& black = players[swapped ? 0 : 1];
+
+                    const auto record = playGame(fen, white, black, tables, stop);
+                    if (record.result < 0.0f) {
+                        continue;
+                    }
+                    const auto score = swapped ? 1.0f - record.result : record.result;
+
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    if (stop) {
+                        continue;
+                    }
+                    wins += score > 0.75f;
+                    draws += score >= 0.25f && score <= 0.75f;
+                    losses += score < 0.25f;
+                    terminations[record.termination]++;
+                    if (pgnFile) {
+                        pgnFile << toPgn(record, fen, game + 1u, white, black) << std::flush;
+                    }
+
+                    const auto llr = sprt.llr(wins, draws, losses);
+                    const auto [elo, margin] = eloEstimate(wins, draws, losses);
+                    std::cout << "Games " << wins + draws + losses << ": +" << wins << " -" << losses << " =" << draws
+                              << std::fixed << std::setprecision(1) << ", elo " << elo << " +- " << margin
+                              << std::setprecision(2) << ", llr " << llr << " [" << sprt.lowerBound() << ", " << sprt.upperBound() << "]"
+                              << std::endl;
+                    if (llr <= sprt.lowerBound() || llr >= sprt.upperBound()) {
+                        stop = true;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        const auto llr = sprt.llr(wins, draws, losses);
+        std::cout << "SPRT elo0 " << sprt.elo0 << ", elo1 " << sprt.elo1 << ": "
+                  << (llr >= sprt.upperBound() ? "H1 accepted" : llr <= sprt.lowerBound() ? "H0 accepted" : "inconclusive") << std::endl;
+        for (const auto& [termination, count] : terminations) {
+            std::cout << "  " << termination << ": " << count << std::endl;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "FATAL: " << ex.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
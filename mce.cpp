@@ -0,0 +1,266 @@
+#include "mce.h"
+#include "ai.hpp"
+#include "board_stats.hpp"
+#include "evaluation.hpp"
+#include "fen.hpp"
+#include "game_end.hpp"
+#include "nnue.hpp"
+#include "notation.hpp"
+#include "tablebase.hpp"
+#include "tt.hpp"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+struct mce_engine {
+    Position position = parseFen(STARTING_FEN);
+    BoardStats boardStats;
+    TranspositionTable table;
+    std::unique_ptr<nnue::Network> network;
+    std::unique_ptr<tablebase::Tablebases> ownTablebases;
+    const tablebase::Tablebases* tablebases = tablebase::defaultTablebases();
+    std::string error;
+
+    // Search in progress, guarded by mutex as stop may come from other thread
+    std::mutex searchMutex;
+    AI* search = nullptr;
+
+    const nnue::Network* evaluationNetwork() const
+    {
+        return network ? network.get() : nnue::defaultNetwork();
+    }
+};
+
+namespace {
+
+// Exceptions must not cross C boundary, they become error of engine
+template <typename F>
+int guarded(mce_engine* engine, F&& f)
+{
+    if (!engine) {
+        return MCE_ERROR;
+    }
+    try {
+        f();
+        engine->error.clear();
+        return MCE_OK;
+    } catch (const std::exception& ex) {
+        engine->error = ex.what();
+    } catch (...) {
+        engine->error = "unknown error";
+    }
+    return MCE_ERROR;
+}
+
+std::string toString(const Move& m)
+{
+    std::ostringstream os;
+    os << m;
+    return os.str();
+}
+
+} // namespace
+
+mce_engine* mce_engine_new(void)
+{
+    try {
+        auto engine = std::make_unique<mce_engine>();
+        engine->position.board.setNetwork(engine->evaluationNetwork());
+        engine->boardStats.visit(engine->position.board);
+        return engine.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void mce_engine_free(mce_engine* engine)
+{
+    delete engine;
+}
+
+const char* mce_version(void)
+{
+    return MCE_VERSION;
+}
+
+const char* mce_last_error(const mce_engine* engine)
+{
+    return engine ? engine->error.c_str() : "";
+}
+
+int mce_set_hash(mce_engine* engine, size_t megabytes)
+{
+    return guarded(engine, [&] {
+        engine->table.resize(megabytes);
+    });
+}
+
+int mce_load_network(mce_engine* engine, const char* path)
+{
+    return guarded(engine, [&] {
+        engine->network = path ? nnue::Network::load(path) : nullptr;
+        engine->position.board.setNetwork(engine->evaluationNetwork());
+    });
+}
+
+int mce_load_tablebases(mce_engine* engine, const char* dir)
+{
+    return guarded(engine, [&] {
+        engine->ownTablebases = dir ? tablebase::Tablebases::load(dir) : nullptr;
+        engine->tablebases = engine->ownTablebases.get();
+    });
+}
+
+int mce_set_position(mce_engine* engine, const char* fen)
+{
+    return guarded(engine, [&] {
+        if (!fen) {
+            throw std::runtime_error("API - missing FEN");
+        }
+        auto position = parseFen(fen);
+        position.board.setNetwork(engine->evaluationNetwork());
+        engine->position = std::move(position);
+        engine->boardStats = BoardStats();
+        engine->boardStats.visit(engine->position.board);
+    });
+}
+
+int mce_play_move(mce_engine* engine, const char* move)
+{
+    return guarded(engine, [&] {
+        auto& position = engine->position;
+        const auto m = move ? findMove(position.board, position.color, move) : std::nullopt;
+        if (!m) {
+            throw std::runtime_error("API - invalid move " + std::string(move ? move : ""));
+        }
+        // Generated moves are pseudo legal, own king must not be left in check
+        auto& b = position.board;
+        const auto c = position.color;
+        bool legal = false;
+        if (castlingAllowed(b, c, *m, b.kingInCheck(c))) {
+            const auto undos = b.applyMove(*m);
+            legal = !b.kingInCheck(c);
+            b.undoMove(undos);
+        }
+        if (!legal) {
+            throw std::runtime_error("API - illegal move " + std::string(move));
+        }
+        b.applyMove(*m);
+        b.clearUndoMoves();
+        engine->boardStats.visit(b);
+        position.color = enemyColor(c);
+    });
+}
+
+int mce_get_position(const mce_engine* engine, char* fen, size_t size)
+{
+    if (!engine || !fen) {
+        return MCE_ERROR;
+    }
+    const auto str = toFen(engine->position.board, engine->position.color);
+    if (str.size() >= size) {
+        return MCE_ERROR;
+    }
+    std::memcpy(fen, str.c_str(), str.size() + 1u);
+    return MCE_OK;
+}
+
+int mce_search(mce_engine* engine, const mce_limits* limits, mce_progress_fn progress, void* user, mce_result* result)
+{
+    return guarded(engine, [&] {
+        // Search works on its own copy, position of engine stays untouched
+        auto board = engine->position.board;
+        AI ai(board, engine->position.color, engine->boardStats);
+        ai.setTranspositionTable(&engine->table);
+        ai.setTablebases(engine->tablebases);
+        if (limits && limits->depth > 0u) {
+            ai.setMaxDepth(limits->depth);
+        }
+        if (limits && limits->movetime_ms > 0u) {
+            ai.setDeadline(AI::Clock::now() + std::chrono::milliseconds(limits->movetime_ms));
+        }
+        if (limits && limits->multipv > 0u) {
+            ai.setMultiPv(limits->multipv);
+        }
+        if (progress) {
+            ai.setInfoCallback([&](size_t depth, std::span<const PvLine> lines) {
+                for (size_t i = 0u; i < lines.size(); i++) {
+                    std::ostringstream pv;
+                    for (const auto& m : lines[i].pv) {
+                        pv << (pv.tellp() > 0 ? " " : "") << m;
+                    }
+                    const auto str = pv.str();
+                    const mce_info info { static_cast<unsigned>(depth), static_cast<unsigned>(i + 1u), lines[i].score, ai.nodes(), str.c_str() };
+                    if (progress(user, &info) != 0) {
+                        ai.stop();
+                    }
+                }
+            });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(engine->searchMutex);
+            engine->search = &ai;
+        }
+        try {
+            ai.run();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(engine->searchMutex);
+            engine->search = nullptr;
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(engine->searchMutex);
+            engine->search = nullptr;
+        }
+
+        if (result) {
+            *result = mce_result {};
+            if (const auto m = ai.bestMove()) {
+                std::strncpy(result->move, toString(*m).c_str(), sizeof(result->move) - 1u);
+                result->score = *ai.bestScore();
+            }
+            result->depth = static_cast<unsigned>(ai.depth());
+            result->nodes = ai.nodes();
+        }
+    });
+}
+
+void mce_stop(mce_engine* engine)
+{
+    if (!engine) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(engine->searchMutex);
+    if (engine->search) {
+        engine->search->stop();
+    }
+}
+
+int mce_evaluate_batch(mce_engine* engine, const char* const* fens, size_t count, int* scores)
+{
+    return guarded(engine, [&] {
+        if (count > 0u && (!fens || !scores)) {
+            throw std::runtime_error("API - missing positions or scores");
+        }
+        auto& evaluator = Evaluator::threadLocal();
+        const auto* network = engine->evaluationNetwork();
+        for (size_t i = 0u; i < count; i++) {
+            if (!fens[i]) {
+                throw std::runtime_error("API - missing FEN at index " + std::to_string(i));
+            }
+            Position position;
+            try {
+                position = parseFen(fens[i]);
+            } catch (const std::exception& ex) {
+                throw std::runtime_error(std::string(ex.what()) + " at index " + std::to_string(i));
+            }
+            position.board.setNetwork(network);
+            scores[i] = evaluator.evaluate(position.board, position.color);
+        }
+    });
+}
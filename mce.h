@@ -0,0 +1,90 @@
+#pragma once
+
+// C API of the engine for in-process use, built as libmce (static and shared)
+//
+// Engine owns position, game history (for repetitions), transposition table and optional network and
+// tablebases. One engine must not be used by two threads at once except mce_stop, different engines
+// can search concurrently. Functions returning int return MCE_OK or MCE_ERROR, message of last error
+// is available from mce_last_error. Scores are in centipawns from side to move's point of view.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define MCE_API __attribute__((visibility("default")))
+#else
+#define MCE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MCE_OK 0
+#define MCE_ERROR (-1)
+
+typedef struct mce_engine mce_engine;
+
+// Zero fields use engine defaults
+typedef struct mce_limits {
+    // Search depth in plies
+    unsigned depth;
+    unsigned movetime_ms;
+    // Number of best root moves reported with exact score
+    unsigned multipv;
+} mce_limits;
+
+// Line of finished iteration, pv is space separated coordinate moves valid during callback only
+typedef struct mce_info {
+    unsigned depth;
+    unsigned multipv;
+    int score;
+    uint64_t nodes;
+    const char* pv;
+} mce_info;
+
+typedef struct mce_result {
+    // Coordinate notation (e2e4), empty if there is no move
+    char move[8];
+    int score;
+    unsigned depth;
+    uint64_t nodes;
+} mce_result;
+
+// Called on searching thread for every line of finished iteration, nonzero return stops search
+typedef int (*mce_progress_fn)(void* user, const mce_info* info);
+
+// Engine starts at the starting position, nullptr if allocation fails
+MCE_API mce_engine* mce_engine_new(void);
+MCE_API void mce_engine_free(mce_engine* engine);
+
+MCE_API const char* mce_version(void);
+// Message of last failed call, empty if none
+MCE_API const char* mce_last_error(const mce_engine* engine);
+
+// Transposition table size in MB, zero disables it, table is kept between searches
+MCE_API int mce_set_hash(mce_engine* engine, size_t megabytes);
+// NNUE network evaluating positions of this engine, nullptr path returns to default evaluation
+MCE_API int mce_load_network(mce_engine* engine, const char* path);
+// Tablebases directory probed by search, nullptr path disables probing
+MCE_API int mce_load_tablebases(mce_engine* engine, const char* dir);
+
+// Resets game history
+MCE_API int mce_set_position(mce_engine* engine, const char* fen);
+// Plays move in coordinate notation, position is kept in history for repetition detection
+MCE_API int mce_play_move(mce_engine* engine, const char* move);
+// Writes FEN of current position, fails if it does not fit
+MCE_API int mce_get_position(const mce_engine* engine, char* fen, size_t size);
+
+// Blocking search of current position, progress may be nullptr, position is not changed
+MCE_API int mce_search(mce_engine* engine, const mce_limits* limits, mce_progress_fn progress, void* user, mce_result* result);
+// Stops running search of engine as soon as possible, safe to call from any thread
+MCE_API void mce_stop(mce_engine* engine);
+
+// Static evaluation of count positions given by FEN into scores, no search is done
+// Stops at first malformed FEN, scores before it are filled
+MCE_API int mce_evaluate_batch(mce_engine* engine, const char* const* fens, size_t count, int* scores);
+
+#ifdef __cplusplus
+}
+#endif
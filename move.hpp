@@ -1,5 +1,6 @@
 #pragma once
 
+#include "arena.hpp"
 #include "figures.hpp"
 
 #include <iostream>
@@ -102,4 +103,6 @@ struct UndoMove : MoveBase {
 };
 
 using Moves = std::vector<Move>;
+// Move list in scratch memory of search thread, default constructed one is on heap
+using MoveList = ArenaVector<Move>;
 using UndoMoves = std::vector<UndoMove>;
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "nnue.hpp"
+#include "square_masks.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace nnue {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'M', 'C', 'E', 'N', 'N', 'U', 'E', '1' };
+constexpr size_t HEADER_SIZE = 64u;
+constexpr int CRELU_MAX = 127;
+
+const Network* network = nullptr;
+
+struct Header {
+    char magic[8];
+    uint32_t hidden;
+    uint32_t l1;
+};
+
+constexpr size_t fileSize()
+{
+    return HEADER_SIZE
+        + NUM_FEATURES * HIDDEN * sizeof(int16_t)
+        + HIDDEN * sizeof(int16_t)
+        + L1 * 2u * HIDDEN * sizeof(int16_t)
+        + L1 * sizeof(int32_t)
+        + L1 * sizeof(int16_t)
+        + sizeof(int32_t);
+}
+
+size_t figureKind(Figure f)
+{
+    switch (f) {
+    case Figure::PAWN:
+    case Figure::PAWN_IDLE:
+    case Figure::PAWN_EN_PASSANT:
+        return 0u;
+    case Figure::KNIGHT:
+        return 1u;
+    case Figure::BISHOP:
+        return 2u;
+    case Figure::ROOK:
+    case Figure::ROOK_IDLE:
+        return 3u;
+    case Figure::QUEEN:
+        return 4u;
+    default:
+        return 5u;
+    }
+}
+
+size_t featureIndex(Color perspective, Square sq, int pos)
+{
+    const auto own = color(sq) == perspective;
+    const auto relativePos = perspective == Color::WHITE ? pos : (pos ^ 56);
+    return ((own ? 0u : 6u) + figureKind(figure(sq))) * 64u + static_cast<size_t>(relativePos);
+}
+
+void addColumn(int16_t* acc, const int16_t* column)
+{
+#if defined(__AVX2__)
+    for (size_t i = 0u; i < HIDDEN; i += 16u) {
+        const auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        const auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi16(a, c));
+    }
+#elif defined(__SSE2__)
+    for (size_t i = 0u; i < HIDDEN; i += 8u) {
+        const auto a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi16(a, c));
+    }
+#else
+    for (size_t i = 0u; i < HIDDEN; i++) {
+        acc[i] += column[i];
+    }
+#endif
+}
+
+void subColumn(int16_t* acc, const int16_t* column)
+{
+#if defined(__AVX2__)
+    for (size_t i = 0u; i < HIDDEN; i += 16u) {
+        const auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        const auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi16(a, c));
+    }
+#elif defined(__SSE2__)
+    for (size_t i = 0u; i < HIDDEN; i += 8u) {
+        const auto a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_sub_epi16(a, c));
+    }
+#else
+    for (size_t i = 0u; i < HIDDEN; i++) {
+        acc[i] -= column[i];
+    }
+#endif
+}
+
+// Clipped ReLU of both perspectives, side to move first
+void transform(const Accumulator& acc, Color c, int16_t* out)
+{
+    const auto* first = acc.values[static_cast<size_t>(c)].data();
+    const auto* second = acc.values[static_cast<size_t>(enemyColor(c))].data();
+
+#if defined(__AVX2__)
+    const auto zero = _mm256_setzero_si256();
+    const auto max = _mm256_set1_epi16(CRELU_MAX);
+    for (size_t i = 0u; i < HIDDEN; i += 16u) {
+        const auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(first + i));
+        const auto b = _mm256_load_si256(reinterpret_cast<const __m256i*>(second + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out + i), _mm256_min_epi16(_mm256_max_epi16(a, zero), max));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out + HIDDEN + i), _mm256_min_epi16(_mm256_max_epi16(b, zero), max));
+    }
+#elif defined(__SSE2__)
+    const auto zero = _mm_setzero_si128();
+    const auto max = _mm_set1_epi16(CRELU_MAX);
+    for (size_t i = 0u; i < HIDDEN; i += 8u) {
+        const auto a = _mm_load_si128(reinterpret_cast<const __m128i*>(first + i));
+        const auto b = _mm_load_si128(reinterpret_cast<const __m128i*>(second + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(out + i), _mm_min_epi16(_mm_max_epi16(a, zero), max));
+        _mm_store_si128(reinterpret_cast<__m128i*>(out + HIDDEN + i), _mm_min_epi16(_mm_max_epi16(b, zero), max));
+    }
+#else
+    for (size_t i = 0u; i < HIDDEN; i++) {
+        out[i] = std::clamp<int16_t>(first[i], 0, CRELU_MAX);
+        out[HIDDEN + i] = std::clamp<int16_t>(second[i], 0, CRELU_MAX);
+    }
+#endif
+}
+
+int32_t dot(const int16_t* a, const int16_t* b, size_t size)
+{
+#if defined(__AVX2__)
+    auto sum = _mm256_setzero_si256();
+    for (size_t i = 0u; i < size; i += 16u) {
+        const auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+    }
+    auto sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum128);
+#elif defined(__SSE2__)
+    auto sum = _mm_setzero_si128();
+    for (size_t i = 0u; i < size; i += 8u) {
+        const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(va, vb));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (size_t i = 0u; i < size; i++) {
+        sum += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return sum;
+#endif
+}
+
+} // namespace
+
+std::unique_ptr<Network> Network::load(const std::string& path)
+{
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("NNUE - unable to open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != fileSize()) {
+        ::close(fd);
+        throw std::runtime_error("NNUE - invalid network size " + path);
+    }
+    auto* mapping = ::mmap(nullptr, fileSize(), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("NNUE - unable to map " + path);
+    }
+
+    std::unique_ptr<Network> net(new Network());
+    net->_mapping = mapping;
+    net->_size = fileSize();
+
+    Header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.hidden != HIDDEN || header.l1 != L1) {
+        throw std::runtime_error("NNUE - incompatible network " + path);
+    }
+
+    const auto* data = static_cast<const char*>(mapping) + HEADER_SIZE;
+    net->_featureWeights = reinterpret_cast<const int16_t*>(data);
+    data += NUM_FEATURES * HIDDEN * sizeof(int16_t);
+    net->_featureBiases = reinterpret_cast<const int16_t*>(data);
+    data += HIDDEN * sizeof(int16_t);
+    net->_l1Weights = reinterpret_cast<const int16_t*>(data);
+    data += L1 * 2u * HIDDEN * sizeof(int16_t);
+    net->_l1Biases = reinterpret_cast<const int32_t*>(data);
+    data += L1 * sizeof(int32_t);
+    net->_outputWeights = reinterpret_cast<const int16_t*>(data);
+    data += L1 * sizeof(int16_t);
+    net->_outputBias = reinterpret_cast<const int32_t*>(data);
+
+    return net;
+}
+
+Network::~Network()
+{
+    if (_mapping) {
+        ::munmap(_mapping, _size);
+    }
+}
+
+void Network::refresh(Accumulator& acc, const std::array<Square, 64u>& squares) const
+{
+    for (auto& values : acc.values) {
+        std::copy(_featureBiases, _featureBiases + HIDDEN, values.begin());
+    }
+    for (auto figures = occupiedMask(squares); figures != 0u; figures &= figures - 1u) {
+        const auto pos = std::countr_zero(figures);
+        const auto sq = squares[pos];
+        for (const auto p : { Color::WHITE, Color::BLACK }) {
+            addColumn(acc.values[static_cast<size_t>(p)].data(), _featureWeights + featureIndex(p, sq, pos) * HIDDEN);
+        }
+    }
+}
+
+void Network::update(Accumulator& acc, int pos, Square oldSq, Square newSq) const
+{
+    for (const auto p : { Color::WHITE, Color::BLACK }) {
+        auto* values = acc.values[static_cast<size_t>(p)].data();
+        if (figure(oldSq) != Figure::NONE) {
+            subColumn(values, _featureWeights + featureIndex(p, oldSq, pos) * HIDDEN);
+        }
+        if (figure(newSq) != Figure::NONE) {
+            addColumn(values, _featureWeights + featureIndex(p, newSq, pos) * HIDDEN);
+        }
+    }
+}
+
+int Network::evaluate(const Accumulator& acc, Color c) const
+{
+    alignas(32) int16_t input[2u * HIDDEN];
+    transform(acc, c, input);
+
+    alignas(32) int16_t hidden[L1];
+    for (size_t j = 0u; j < L1; j++) {
+        const auto sum = (_l1Biases[j] + dot(input, _l1Weights + j * 2u * HIDDEN, 2u * HIDDEN)) >> L1_SHIFT;
+        hidden[j] = static_cast<int16_t>(std::clamp(sum, 0, CRELU_MAX));
+    }
+
+    return (*_outputBias + dot(hidden, _outputWeights, L1)) / OUTPUT_SCALE;
+}
+
+const Network* defaultNetwork()
+{
+    return network;
+}
+
+void setDefaultNetwork(const Network* net)
+{
+    network = net;
+}
+
+} // namespace nnue
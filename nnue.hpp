@@ -0,0 +1,75 @@
+#pragma once
+
+#include "figures.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Efficiently updatable neural network evaluation, CPU only
+//
+// Features are figure kind x color x square (768), seen from both colors' perspective
+// (black perspective flips ranks). Feature transformer output is accumulated incrementally,
+// every Board::set only subtracts the old and adds the new feature column.
+//
+// Network file is memory mapped as is (little endian):
+//   header            64 B, "MCENNUE1", uint32 HIDDEN, uint32 L1, zero padding
+//   feature weights   int16 [NUM_FEATURES][HIDDEN]
+//   feature biases    int16 [HIDDEN]
+//   l1 weights        int16 [L1][2 * HIDDEN]
+//   l1 biases         int32 [L1]
+//   output weights    int16 [L1]
+//   output bias       int32
+//
+// x   = crelu(accumulator[side to move] ++ accumulator[other side])
+// h_j = crelu((l1_bias_j + sum_i x_i * l1_weight_ji) >> L1_SHIFT)
+// eval = (output_bias + sum_j h_j * output_weight_j) / OUTPUT_SCALE
+// where crelu clamps into [0, 127]
+
+namespace nnue {
+
+constexpr size_t NUM_FEATURES = 768u;
+constexpr size_t HIDDEN = 128u;
+constexpr size_t L1 = 32u;
+constexpr int L1_SHIFT = 6;
+constexpr int OUTPUT_SCALE = 16;
+
+struct alignas(32) Accumulator {
+    // Indexed by perspective color
+    std::array<std::array<int16_t, HIDDEN>, 2u> values;
+};
+
+class Network {
+public:
+    // Throws if file is missing or has different layout
+    static std::unique_ptr<Network> load(const std::string& path);
+
+    Network(const Network&) = delete;
+    Network& operator=(const Network&) = delete;
+    ~Network();
+
+    void refresh(Accumulator& acc, const std::array<Square, 64u>& squares) const;
+    // Subtracts old square's feature columns and adds new one's
+    void update(Accumulator& acc, int pos, Square oldSq, Square newSq) const;
+    // Score from c's point of view
+    int evaluate(const Accumulator& acc, Color c) const;
+
+private:
+    void* _mapping = nullptr;
+    size_t _size = 0u;
+    const int16_t* _featureWeights = nullptr;
+    const int16_t* _featureBiases = nullptr;
+    const int16_t* _l1Weights = nullptr;
+    const int32_t* _l1Biases = nullptr;
+    const int16_t* _outputWeights = nullptr;
+    const int32_t* _outputBias = nullptr;
+
+    Network() = default;
+};
+
+// Network attached to every newly created Board, nullptr means PST evaluation
+const Network* defaultNetwork();
+void setDefaultNetwork(const Network* network);
+
+} // namespace nnue
@@ -0,0 +1,212 @@
+#include "notation.hpp"
+#include "arena.hpp"
+#include "game_end.hpp"
+
+#include <array>
+
+std::optional<Move> findMove(const Board& b, Color c, const std::string& str)
+{
+    if (str.size() < 4u) {
+        return std::nullopt;
+    }
+    const Point from = { str[0] - 'a', str[1] - '1' };
+    const Point to = { str[2] - 'a', str[3] - '1' };
+
+    for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
+        for (const auto& m : generator.movesChunk()) {
+            if (m.from == from && m.to == to) {
+                return m;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+namespace {
+
+constexpr std::string_view SAN_SUFFIXES = "+#!?";
+// Figures of one kind reaching one square come from eight directions (or knight jumps) at most
+constexpr size_t MAX_SAN_CANDIDATES = 8u;
+
+char figureLetter(Figure f)
+{
+    switch (f) {
+    case Figure::KNIGHT:
+        return 'N';
+    case Figure::BISHOP:
+        return 'B';
+    case Figure::ROOK:
+    case Figure::ROOK_IDLE:
+        return 'R';
+    case Figure::QUEEN:
+        return 'Q';
+    case Figure::KING:
+    case Figure::KING_IDLE:
+        return 'K';
+    default:
+        return 'P';
+    }
+}
+
+std::optional<Move> findCastling(const MoveList& moves, Color c, bool queenSide)
+{
+    const Point to = { queenSide ? 2 : Board::WIDTH - 2, c == Color::WHITE ? 0 : Board::HEIGHT - 1 };
+
+    for (const auto& m : moves) {
+        if (m.type == MoveType::CASTLING && m.to == to) {
+            return m;
+        }
+    }
+    return std::nullopt;
+}
+
+// Own king is not left in check
+bool legal(Board& b, Color c, const Move& m)
+{
+    const auto undos = b.applyMove(m);
+    const auto check = b.kingInCheck(c);
+    b.undoMove(undos);
+    return !check;
+}
+
+} // namespace
+
+std::optional<Move> findSanMove(Board& b, Color c, std::string_view san)
+{
+    while (!san.empty() && SAN_SUFFIXES.find(san.back()) != std::string_view::npos) {
+        san.remove_suffix(1u);
+    }
+    // Moves go to scratch memory of calling thread, so parsing a game does not allocate per move
+    auto& arena = Arena::threadLocal();
+    const Arena::Scope scope(arena);
+    MoveList moves(arena);
+    for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
+        generator.movesChunk(moves);
+    }
+    if (san == "O-O" || san == "0-0") {
+        return findCastling(moves, c, false);
+    }
+    if (san == "O-O-O" || san == "0-0-0") {
+        return findCastling(moves, c, true);
+    }
+    if (san.size() < 2u) {
+        return std::nullopt;
+    }
+
+    char letter = 'P';
+    if (std::string_view("NBRQK").find(san.front()) != std::string_view::npos) {
+        letter = san.front();
+        san.remove_prefix(1u);
+    }
+    // Promotion, e8=Q or e8Q
+    if (letter == 'P' && !san.empty() && std::string_view("NBRQ").find(san.back()) != std::string_view::npos) {
+        if (san.back() != 'Q') {
+            return std::nullopt;
+        }
+        san.remove_suffix(san.size() > 2u && san[san.size() - 2u] == '=' ? 2u : 1u);
+    }
+    if (san.size() < 2u) {
+        return std::nullopt;
+    }
+    const Point to = { san[san.size() - 2u] - 'a', san[san.size() - 1u] - '1' };
+    if (!Board::validIndex(to.x, to.y)) {
+        return std::nullopt;
+    }
+    san.remove_suffix(2u);
+
+    // Disambiguation, capture mark is ignored
+    std::optional<int> fromX;
+    std::optional<int> fromY;
+    for (const auto ch : san) {
+        if (ch >= 'a' && ch <= 'h') {
+            fromX = ch - 'a';
+        } else if (ch >= '1' && ch <= '8') {
+            fromY = ch - '1';
+        } else if (ch != 'x') {
+            return std::nullopt;
+        }
+    }
+    // Pawn moves straight unless capture names its file
+    if (letter == 'P' && !fromX) {
+        fromX = to.x;
+    }
+
+    std::array<Move, MAX_SAN_CANDIDATES> candidates;
+    size_t numCandidates = 0u;
+    for (const auto& m : moves) {
+        if (!(m.to == to) || m.type == MoveType::CASTLING || figureLetter(figure(b.get(m.from.x, m.from.y))) != letter
+            || (fromX && *fromX != m.from.x) || (fromY && *fromY != m.from.y)) {
+            continue;
+        }
+        if (numCandidates == candidates.size()) {
+            return std::nullopt;
+        }
+        candidates[numCandidates++] = m;
+    }
+    // SAN disambiguates only among legal moves, pinned figure may match too
+    std::optional<Move> found;
+    for (size_t i = 0u; i < numCandidates; i++) {
+        const auto& m = candidates[i];
+        if (!legal(b, c, m)) {
+            continue;
+        }
+        if (found) {
+            // Still ambiguous
+            return std::nullopt;
+        }
+        found = m;
+    }
+    return found;
+}
+
+std::string toSan(Board& b, Color c, const Move& m)
+{
+    std::string san;
+    const auto letter = figureLetter(figure(b.get(m.from.x, m.from.y)));
+
+    if (m.type == MoveType::CASTLING) {
+        san = m.to.x < m.from.x ? "O-O-O" : "O-O";
+    } else {
+        const auto capture = b.isCapture(m);
+        if (letter != 'P') {
+            san += letter;
+            // Other figure of same kind legally reaching same square, pinned one needs no disambiguation
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
+                for (const auto& other : generator.movesChunk()) {
+                    if (!(other.to == m.to) || other.from == m.from || figureLetter(figure(b.get(other.from.x, other.from.y))) != letter
+                        || !legal(b, c, other)) {
+                        continue;
+                    }
+                    ambiguous = true;
+                    sameFile = sameFile || other.from.x == m.from.x;
+                    sameRank = sameRank || other.from.y == m.from.y;
+                }
+            }
+            if (ambiguous && (!sameFile || sameRank)) {
+                san += static_cast<char>('a' + m.from.x);
+            }
+            if (ambiguous && sameFile) {
+                san += static_cast<char>('1' + m.from.y);
+            }
+        } else if (capture) {
+            san += static_cast<char>('a' + m.from.x);
+        }
+        if (capture) {
+            san += 'x';
+        }
+        san += static_cast<char>('a' + m.to.x);
+        san += static_cast<char>('1' + m.to.y);
+        if (letter == 'P' && (m.to.y == 0 || m.to.y == Board::HEIGHT - 1)) {
+            san += "=Q";
+        }
+    }
+
+    const auto undos = b.applyMove(m);
+    const auto enemy = enemyColor(c);
+    if (b.kingInCheck(enemy)) {
+        san += hasLegalMove(b, enemy) ? '+' : '#';
+    }
+    b.undoMove(undos);
+    return san;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Finds generated move of given color matching coordinate notation (e.g. e2e4, e7e8q)
+std::optional<Move> findMove(const Board& b, Color c, const std::string& str);
+
+// Finds generated move of given color matching standard algebraic notation (e.g. Nbd7, exd6, O-O, e8=Q+)
+// Only legal move is found, nullopt if several legal moves match. Board is used for legality test and is restored afterwards
+// Underpromotions are not supported by the engine and are not found
+std::optional<Move> findSanMove(Board& b, Color c, std::string_view san);
+
+// Standard algebraic notation of generated move, including check and mate suffix
+// Board is used to detect check and pinned figures and is restored afterwards
+std::string toSan(Board& b, Color c, const Move& m);
@@ -0,0 +1,252 @@
+#include "pgn.hpp"
+#include "fen.hpp"
+#include "notation.hpp"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pgn {
+
+namespace {
+
+constexpr std::string_view WHITESPACE = " \t\r\n";
+// Characters ending token besides whitespace
+constexpr std::string_view DELIMITERS = " \t\r\n{}();[";
+
+// Tag section starting on line after blank line, lines may end with CRLF
+size_t findGameBoundary(std::string_view data, size_t pos)
+{
+    for (pos = data.find("\n[", pos); pos != std::string_view::npos; pos = data.find("\n[", pos + 1u)) {
+        const auto lineEnd = pos > 0u && data[pos - 1u] == '\r' ? pos - 1u : pos;
+        if (lineEnd > 0u && data[lineEnd - 1u] == '\n') {
+            return pos + 1u;
+        }
+    }
+    return std::string_view::npos;
+}
+
+bool isResult(std::string_view token)
+{
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+// Movetext scanner, comments, variations and NAGs are skipped
+class Tokenizer {
+public:
+    explicit Tokenizer(std::string_view text)
+        : _text(text)
+    {
+    }
+
+    size_t position() const
+    {
+        return _pos;
+    }
+
+    // Empty at end of text or at tag section of next game
+    std::string_view next()
+    {
+        int variation = 0;
+        while (_pos < _text.size()) {
+            const auto ch = _text[_pos];
+            if (WHITESPACE.find(ch) != std::string_view::npos) {
+                _pos++;
+            } else if (ch == '{') {
+                skipPast('}');
+            } else if (ch == ';') {
+                skipPast('\n');
+            } else if (ch == '(') {
+                variation++;
+                _pos++;
+            } else if (ch == ')') {
+                variation = std::max(variation - 1, 0);
+                _pos++;
+            } else if (ch == '[' && variation == 0 && (_pos == 0u || _text[_pos - 1u] == '\n')) {
+                return {};
+            } else {
+                const auto end = std::min(_text.find_first_of(DELIMITERS, _pos + 1u), _text.size());
+                const auto token = _text.substr(_pos, end - _pos);
+                _pos = end;
+                if (variation == 0 && token.front() != '$') {
+                    return token;
+                }
+            }
+        }
+        return {};
+    }
+
+private:
+    std::string_view _text;
+    size_t _pos = 0u;
+
+    void skipPast(char ch)
+    {
+        const auto end = _text.find(ch, _pos);
+        _pos = end == std::string_view::npos ? _text.size() : end + 1u;
+    }
+};
+
+// Move number prefix (12. or 12...) is stripped, it may be glued to move
+std::string_view stripMoveNumber(std::string_view token)
+{
+    if (token.empty() || token.front() < '0' || token.front() > '9' || isResult(token)) {
+        return token;
+    }
+    const auto end = token.find_first_not_of("0123456789.");
+    return end == std::string_view::npos ? std::string_view {} : token.substr(end);
+}
+
+} // namespace
+
+std::string_view Game::tag(std::string_view name) const
+{
+    for (size_t pos = tags.find('['); pos != std::string_view::npos; pos = tags.find('[', pos + 1u)) {
+        const auto line = tags.substr(pos + 1u, tags.find(']', pos) - pos - 1u);
+        if (line.substr(0u, name.size()) != name || line.size() <= name.size() || line[name.size()] != ' ') {
+            continue;
+        }
+        const auto begin = line.find('"');
+        const auto end = line.rfind('"');
+        if (begin == std::string_view::npos || end <= begin) {
+            return {};
+        }
+        return line.substr(begin + 1u, end - begin - 1u);
+    }
+    return {};
+}
+
+float Game::result() const
+{
+    const auto r = tag("Result");
+    if (r == "1-0") {
+        return 1.0f;
+    }
+    if (r == "0-1") {
+        return 0.0f;
+    }
+    if (r == "1/2-1/2") {
+        return 0.5f;
+    }
+    return -1.0f;
+}
+
+std::unique_ptr<File> File::load(const std::string& path)
+{
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("PGN - unable to open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("PGN - unable to read " + path);
+    }
+    std::unique_ptr<File> file(new File());
+    file->_size = static_cast<size_t>(st.st_size);
+
+    // Empty file cannot be mapped
+    if (file->_size > 0u) {
+        auto* mapping = ::mmap(nullptr, file->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("PGN - unable to map " + path);
+        }
+        // File is read front to back once
+        ::madvise(mapping, file->_size, MADV_SEQUENTIAL);
+        file->_mapping = mapping;
+    }
+    ::close(fd);
+    return file;
+}
+
+File::~File()
+{
+    if (_mapping) {
+        ::munmap(_mapping, _size);
+    }
+}
+
+std::vector<std::string_view> File::split(size_t parts) const
+{
+    const auto data = text();
+    std::vector<std::string_view> slices;
+    size_t begin = 0u;
+
+    for (size_t i = 1u; i <= parts && begin < data.size(); i++) {
+        auto end = i == parts ? data.size() : std::max(begin, data.size() / parts * i);
+        if (end < data.size()) {
+            const auto boundary = findGameBoundary(data, end);
+            end = boundary == std::string_view::npos ? data.size() : boundary;
+        }
+        slices.push_back(data.substr(begin, end - begin));
+        begin = end;
+    }
+    return slices;
+}
+
+void forEachGame(std::string_view text, const std::function<void(const Game&)>& f)
+{
+    size_t pos = 0u;
+    while (true) {
+        pos = text.find_first_not_of(WHITESPACE, pos);
+        if (pos == std::string_view::npos) {
+            return;
+        }
+        Game game;
+        const auto tagsBegin = pos;
+        while (pos < text.size() && text[pos] == '[') {
+            pos = std::min(text.find('\n', pos), text.size());
+            pos = std::min(text.find_first_not_of(WHITESPACE, pos), text.size());
+        }
+        game.tags = text.substr(tagsBegin, pos - tagsBegin);
+
+        // Movetext ends with result token or where tag section of next game starts
+        Tokenizer tokenizer(text.substr(pos));
+        for (auto token = tokenizer.next(); !token.empty() && !isResult(token); token = tokenizer.next()) {
+        }
+        game.moves = text.substr(pos, tokenizer.position());
+        pos += tokenizer.position();
+
+        if (game.moves.empty() && game.tags.empty()) {
+            // Stray character which is neither tag nor movetext
+            pos++;
+            continue;
+        }
+        f(game);
+    }
+}
+
+size_t replay(const Game& game, const std::function<bool(const Board&, Color, const Move&, size_t)>& f)
+{
+    const auto fen = game.tag("FEN");
+    auto position = fen.empty() ? Position {} : parseFen(std::string(fen));
+    auto& board = position.board;
+    auto color = position.color;
+    size_t ply = 0u;
+
+    Tokenizer tokenizer(game.moves);
+    for (auto token = tokenizer.next(); !token.empty(); token = tokenizer.next()) {
+        const auto san = stripMoveNumber(token);
+        if (san.empty()) {
+            continue;
+        }
+        if (isResult(san)) {
+            break;
+        }
+        const auto m = findSanMove(board, color, san);
+        if (!m || !f(board, color, *m, ply)) {
+            break;
+        }
+        board.applyMove(*m);
+        board.clearUndoMoves();
+        color = enemyColor(color);
+        ply++;
+    }
+    return ply;
+}
+
+} // namespace pgn
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Streaming PGN reader, every view points into memory mapped file, tokens are never copied
+namespace pgn {
+
+struct Game {
+    // Tag pair section and movetext including result token
+    std::string_view tags;
+    std::string_view moves;
+
+    // Value of tag, empty if missing
+    std::string_view tag(std::string_view name) const;
+    // 1 white wins, 0.5 draw, 0 black wins, negative if unknown (*)
+    float result() const;
+};
+
+class File {
+public:
+    // Throws if file cannot be opened
+    static std::unique_ptr<File> load(const std::string& path);
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File();
+
+    std::string_view text() const
+    {
+        return { static_cast<const char*>(_mapping), _size };
+    }
+
+    // At most parts consecutive slices split at game boundaries (blank line before tag section)
+    std::vector<std::string_view> split(size_t parts) const;
+
+private:
+    void* _mapping = nullptr;
+    size_t _size = 0u;
+
+    File() = default;
+};
+
+// Calls f for every game in text
+void forEachGame(std::string_view text, const std::function<void(const Game&)>& f);
+
+// Replays game from FEN tag or starting position, f(board, color, move, ply) is called before
+// every move is applied and returns false to stop. Returns number of replayed plies, replay also
+// stops at first move which cannot be parsed
+size_t replay(const Game& game, const std::function<bool(const Board&, Color, const Move&, size_t)>& f);
+
+} // namespace pgn
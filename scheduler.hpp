@@ -0,0 +1,179 @@
+#pragma once
+
+#include "search_task.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Interleaves many searches on fixed number of workers, one per core is enough
+// Searches are resumed for one slice at a time, job stays on worker it was given to, so it reuses
+// thread local tables of that worker. Worker picks job with deadline already passed (it stops within
+// the slice), otherwise job with lowest pass. Pass grows by STRIDE / priority every slice (stride scheduling),
+// so job with priority 2 gets twice as many slices as job with priority 1
+class SearchScheduler final {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Done = std::function<void(std::exception_ptr)>;
+
+    SearchScheduler(size_t numThreads, size_t sliceNodes)
+        : _sliceNodes(std::max<size_t>(sliceNodes, 1u))
+        , _workers(std::max<size_t>(numThreads, 1u))
+    {
+        for (auto& w : _workers) {
+            w.thread = std::thread([this, &w] {
+                work(w);
+            });
+        }
+    }
+
+    SearchScheduler(const SearchScheduler&) = delete;
+    SearchScheduler& operator=(const SearchScheduler&) = delete;
+
+    ~SearchScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _jobAvailable.notify_all();
+        for (auto& w : _workers) {
+            w.thread.join();
+        }
+    }
+
+    // Nodes searched per resume, searches submitted here should be created with it
+    size_t sliceNodes() const
+    {
+        return _sliceNodes;
+    }
+
+    size_t numThreads() const
+    {
+        return _workers.size();
+    }
+
+    // Done is called on worker thread once task is finished, it may keep search state alive
+    // Exception thrown by search finishes the task too, done gets it (null if search succeeded)
+    void submit(SearchTask task, size_t priority, std::optional<Clock::time_point> deadline, Done done)
+    {
+        auto job = std::make_unique<Job>();
+        job->done = std::move(done);
+        job->task = std::move(task);
+        job->priority = std::max<size_t>(priority, 1u);
+        job->deadline = deadline;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto& w = *std::min_element(_workers.begin(), _workers.end(), [](const auto& a, const auto& b) {
+                return a.jobs.size() + a.running < b.jobs.size() + b.running;
+            });
+            // New job does not get slices other jobs were given before
+            job->pass = w.time;
+            w.jobs.push_back(std::move(job));
+            _pending++;
+        }
+        _jobAvailable.notify_all();
+    }
+
+    // Blocks until all submitted jobs are finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle.wait(lock, [this] {
+            return _pending == 0u;
+        });
+    }
+
+private:
+    static constexpr uint64_t STRIDE = 1u << 16u;
+
+    struct Job {
+        Done done;
+        // Destroyed before done is called, done may own search the task refers to
+        std::optional<SearchTask> task;
+        size_t priority = 1u;
+        std::optional<Clock::time_point> deadline;
+        uint64_t pass = 0u;
+    };
+
+    struct Worker {
+        std::vector<std::unique_ptr<Job>> jobs;
+        // Pass of last resumed job
+        uint64_t time = 0u;
+        size_t running = 0u;
+        std::thread thread;
+    };
+
+    const size_t _sliceNodes;
+    std::vector<Worker> _workers;
+    size_t _pending = 0u;
+    bool _quit = false;
+    std::mutex _mutex;
+    std::condition_variable _jobAvailable;
+    std::condition_variable _idle;
+
+    static std::unique_ptr<Job> pick(Worker& w)
+    {
+        const auto now = Clock::now();
+        const auto overdue = [now](const auto& job) {
+            return job->deadline && *job->deadline <= now;
+        };
+        auto it = std::find_if(w.jobs.begin(), w.jobs.end(), overdue);
+        if (it == w.jobs.end()) {
+            it = std::min_element(w.jobs.begin(), w.jobs.end(), [](const auto& a, const auto& b) {
+                return a->pass < b->pass;
+            });
+        }
+        auto job = std::move(*it);
+        w.jobs.erase(it);
+        return job;
+    }
+
+    void work(Worker& w)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _jobAvailable.wait(lock, [this, &w] {
+                return _quit || !w.jobs.empty();
+            });
+            if (w.jobs.empty()) {
+                // Quit only after jobs are finished
+                return;
+            }
+            auto job = pick(w);
+            w.time = job->pass;
+            w.running++;
+            lock.unlock();
+
+            bool finished = true;
+            std::exception_ptr error;
+            try {
+                finished = job->task->resume();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (finished) {
+                job->task.reset();
+                job->done(error);
+                job.reset();
+            }
+
+            lock.lock();
+            w.running--;
+            if (!finished) {
+                job->pass += STRIDE / job->priority;
+                w.jobs.push_back(std::move(job));
+            } else if (--_pending == 0u) {
+                _idle.notify_all();
+            }
+        }
+    }
+};
@@ -0,0 +1,75 @@
+#include "search_stats.hpp"
+
+#include <cmath>
+
+std::ostream& operator<<(std::ostream& os, const IterationStats& s)
+{
+    const auto& c = s.counters;
+    const auto cutoffRate = c.betaCutoffs > 0u ? static_cast<double>(c.firstMoveBetaCutoffs) / c.betaCutoffs : 0.0;
+
+    return os << "{\"depth\":" << s.depth
+              << ",\"completed\":" << (s.completed ? "true" : "false")
+              << ",\"time_us\":" << s.time.count()
+              << ",\"nodes\":" << c.nodes
+              << ",\"leaf_nodes\":" << c.leafNodes
+              << ",\"qnodes\":" << c.qNodes
+              << ",\"see_pruned_captures\":" << c.seePrunedCaptures
+              << ",\"tablebase_hits\":" << c.tablebaseHits
+              << ",\"tt_hits\":" << c.ttHits
+              << ",\"tt_cutoffs\":" << c.ttCutoffs
+              << ",\"reverse_futility_cutoffs\":" << c.reverseFutilityCutoffs
+              << ",\"razor_cutoffs\":" << c.razorCutoffs
+              << ",\"futility_pruned\":" << c.futilityPruned
+              << ",\"generated_moves\":" << c.generatedMoves
+              << ",\"beta_cutoffs\":" << c.betaCutoffs
+              << ",\"first_move_beta_cutoffs\":" << c.firstMoveBetaCutoffs
+              << ",\"first_move_cutoff_rate\":" << cutoffRate
+              << ",\"researches\":" << c.researches
+              << ",\"ebf\":" << s.ebf
+              << "}";
+}
+
+#ifdef MCE_SEARCH_STATS
+
+void SearchStats::beginIteration()
+{
+    searchCounters = {};
+    _iterationTime = {};
+    _iterationStart = std::chrono::steady_clock::now();
+}
+
+void SearchStats::suspend()
+{
+    _counters = searchCounters;
+    _iterationTime += std::chrono::steady_clock::now() - _iterationStart;
+}
+
+void SearchStats::resume()
+{
+    searchCounters = _counters;
+    _iterationStart = std::chrono::steady_clock::now();
+}
+
+void SearchStats::endIteration(size_t depth, bool completed)
+{
+    using namespace std::chrono;
+
+    IterationStats s;
+    s.depth = depth;
+    s.completed = completed;
+    s.time = duration_cast<microseconds>(_iterationTime + (steady_clock::now() - _iterationStart));
+    s.counters = searchCounters;
+
+    if (!_iterations.empty() && _iterations.back().counters.nodes > 0u) {
+        const auto& prev = _iterations.back();
+        const auto ratio = static_cast<double>(s.counters.nodes) / prev.counters.nodes;
+        s.ebf = std::pow(ratio, 1.0 / static_cast<double>(depth - prev.depth));
+    }
+    _iterations.push_back(s);
+
+    if (_output) {
+        *_output << s << std::endl;
+    }
+}
+
+#endif
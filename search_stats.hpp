@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Search statistics are compiled in only with MCE_SEARCH_STATS (cmake -DMCE_SEARCH_STATS=ON)
+// Otherwise SEARCH_STAT_* macros expand to nothing and SearchStats methods are empty
+
+struct SearchCounters {
+    size_t nodes = 0u;
+    size_t leafNodes = 0u;
+    size_t qNodes = 0u;
+    // Captures skipped in quiescence because SEE says they lose material
+    size_t seePrunedCaptures = 0u;
+    // Nodes resolved by endgame tablebase probe
+    size_t tablebaseHits = 0u;
+    // Nodes finding their position in transposition table, of them resolved by entry of sufficient depth
+    size_t ttHits = 0u;
+    size_t ttCutoffs = 0u;
+    // Frontier pruning: nodes failing high on static score, nodes resolved by quiescence, skipped quiet moves
+    size_t reverseFutilityCutoffs = 0u;
+    size_t razorCutoffs = 0u;
+    size_t futilityPruned = 0u;
+    size_t generatedMoves = 0u;
+    size_t betaCutoffs = 0u;
+    // Cutoffs caused by first searched move, measures move ordering quality
+    size_t firstMoveBetaCutoffs = 0u;
+    // Null window searches which failed high and had to be searched again
+    size_t researches = 0u;
+};
+
+struct IterationStats {
+    size_t depth = 0u;
+    bool completed = false;
+    std::chrono::microseconds time {};
+    SearchCounters counters;
+    // Effective branching factor per depth unit, zero for first iteration
+    double ebf = 0.0;
+};
+
+// Single JSON line, without newline
+std::ostream& operator<<(std::ostream& os, const IterationStats& s);
+
+#ifdef MCE_SEARCH_STATS
+
+// Every search thread counts into its own copy, aggregated at the end of iteration
+// Searches interleaved on one thread swap it in and out by SearchStats::suspend and resume
+inline thread_local SearchCounters searchCounters;
+
+#define SEARCH_STAT_INC(counter) (searchCounters.counter++)
+#define SEARCH_STAT_ADD(counter, n) (searchCounters.counter += (n))
+
+class SearchStats {
+public:
+    // Every finished iteration is written as JSON line
+    void setOutput(std::ostream* os)
+    {
+        _output = os;
+    }
+
+    // Must be called from search thread
+    void beginIteration();
+    void endIteration(size_t depth, bool completed);
+
+    // Search giving its thread to other searches keeps its counters aside until it is resumed,
+    // time it spends suspended is not counted into iteration
+    void suspend();
+    void resume();
+
+    const std::vector<IterationStats>& iterations() const
+    {
+        return _iterations;
+    }
+
+private:
+    std::ostream* _output = nullptr;
+    std::vector<IterationStats> _iterations;
+    std::chrono::steady_clock::time_point _iterationStart;
+    std::chrono::steady_clock::duration _iterationTime {};
+    SearchCounters _counters;
+};
+
+#else
+
+#define SEARCH_STAT_INC(counter) ((void)0)
+#define SEARCH_STAT_ADD(counter, n) ((void)0)
+
+class SearchStats {
+public:
+    void setOutput(std::ostream*)
+    {
+    }
+
+    void beginIteration()
+    {
+    }
+
+    void endIteration(size_t, bool)
+    {
+    }
+
+    void suspend()
+    {
+    }
+
+    void resume()
+    {
+    }
+
+    const std::vector<IterationStats>& iterations() const
+    {
+        static const std::vector<IterationStats> none;
+        return none;
+    }
+};
+
+#endif
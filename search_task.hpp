@@ -0,0 +1,93 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// Resumable search returned by AI::search, it suspends only between root moves
+// Task starts suspended and owns coroutine frame, AI has to outlive it
+class SearchTask final {
+public:
+    struct promise_type {
+        std::exception_ptr exception;
+
+        SearchTask get_return_object()
+        {
+            return SearchTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    SearchTask(SearchTask&& task) noexcept
+        : _handle(std::exchange(task._handle, nullptr))
+    {
+    }
+
+    SearchTask& operator=(SearchTask&& task) noexcept
+    {
+        if (this != &task) {
+            destroy();
+            _handle = std::exchange(task._handle, nullptr);
+        }
+        return *this;
+    }
+
+    SearchTask(const SearchTask&) = delete;
+    SearchTask& operator=(const SearchTask&) = delete;
+
+    ~SearchTask()
+    {
+        destroy();
+    }
+
+    // Runs search until next suspension, returns true once search is finished
+    // Exception thrown by search is rethrown here
+    bool resume()
+    {
+        if (!_handle.done()) {
+            _handle.resume();
+        }
+        if (_handle.promise().exception) {
+            std::rethrow_exception(std::exchange(_handle.promise().exception, nullptr));
+        }
+        return _handle.done();
+    }
+
+    bool done() const
+    {
+        return _handle.done();
+    }
+
+private:
+    std::coroutine_handle<promise_type> _handle;
+
+    explicit SearchTask(std::coroutine_handle<promise_type> handle)
+        : _handle(handle)
+    {
+    }
+
+    void destroy()
+    {
+        if (_handle) {
+            _handle.destroy();
+        }
+    }
+};
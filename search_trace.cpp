@@ -0,0 +1,113 @@
+#include "search_trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char MAGIC[8] = { 'M', 'C', 'E', 'T', 'R', '0', '0', '1' };
+
+SearchTrace* traceDefault = nullptr;
+
+} // namespace
+
+SearchTrace::SearchTrace(const std::string& path)
+    : _file(std::fopen(path.c_str(), "wb"))
+{
+    if (!_file) {
+        throw std::runtime_error("Trace - unable to create " + path);
+    }
+    Header header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.recordSize = sizeof(TraceRecord);
+    std::fwrite(&header, sizeof(header), 1u, _file);
+
+    _writer = std::thread([this] {
+        write();
+    });
+}
+
+SearchTrace::~SearchTrace()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Partially filled chunks
+        for (auto& [id, buffer] : _buffers) {
+            auto& chunk = buffer->_chunks[buffer->_current];
+            if (chunk.count > 0u && !chunk.writing) {
+                chunk.writing = true;
+                _queue.emplace_back(buffer->_thread, &chunk);
+            }
+        }
+        _quit = true;
+    }
+    _chunkQueued.notify_all();
+    _writer.join();
+    std::fclose(_file);
+}
+
+SearchTrace::Buffer& SearchTrace::buffer()
+{
+    const auto id = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = std::find_if(_buffers.begin(), _buffers.end(), [id](const auto& b) {
+        return b.first == id;
+    });
+    if (it != _buffers.end()) {
+        return *it->second;
+    }
+    _buffers.emplace_back(id, std::unique_ptr<Buffer>(new Buffer(*this, static_cast<uint32_t>(_buffers.size()))));
+    return *_buffers.back().second;
+}
+
+void SearchTrace::submit(Buffer& buffer)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto& chunk = buffer._chunks[buffer._current];
+    chunk.writing = true;
+    _queue.emplace_back(buffer._thread, &chunk);
+    _chunkQueued.notify_one();
+
+    buffer._current = (buffer._current + 1u) % CHUNKS_PER_THREAD;
+    auto& next = buffer._chunks[buffer._current];
+    // Search waits rather than losing records
+    _chunkWritten.wait(lock, [&next] {
+        return !next.writing;
+    });
+}
+
+void SearchTrace::write()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _chunkQueued.wait(lock, [this] {
+            return _quit || !_queue.empty();
+        });
+        if (_queue.empty()) {
+            return;
+        }
+        const auto [thread, chunk] = _queue.front();
+        _queue.pop_front();
+        lock.unlock();
+
+        const uint32_t header[2] = { thread, chunk->count };
+        std::fwrite(header, sizeof(header), 1u, _file);
+        std::fwrite(chunk->records.data(), sizeof(TraceRecord), chunk->count, _file);
+
+        lock.lock();
+        chunk->count = 0u;
+        chunk->writing = false;
+        _chunkWritten.notify_all();
+    }
+}
+
+SearchTrace* defaultTrace()
+{
+    return traceDefault;
+}
+
+void setDefaultTrace(SearchTrace* trace)
+{
+    traceDefault = trace;
+}
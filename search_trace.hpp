@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary trace of negascout nodes for offline analysis by mce_trace
+//
+// Every negascout node with remaining depth writes one record when it returns (post-order),
+// quiescence nodes are only counted in subtree sizes. Records of a thread are collected in its
+// preallocated ring of chunks, full chunks are written to file by background thread.
+// File is 16 B header ("MCETR001", uint32 record size, uint32 zero) followed by chunks of
+// uint32 thread index, uint32 record count and records. Records of one thread are in search order,
+// so node's children are records of the next ply preceding it back to previous record of its ply.
+//
+// Search without trace runs negascout instantiated without tracing code, so tracing costs nothing
+// unless enabled (mce --trace <file>).
+
+enum class TraceNode : uint8_t {
+    // Score inside window
+    PV,
+    // Fail high
+    CUT,
+    // Fail low
+    ALL,
+    TT_CUTOFF,
+    TABLEBASE,
+    REVERSE_FUTILITY,
+    RAZOR,
+    // King captured or search stopped
+    LEAF,
+    // Checkmate, stalemate or insufficient material
+    TERMINAL
+};
+
+struct TraceRecord {
+    // Nodes searched in subtree including this node and quiescence
+    uint32_t subtree = 0u;
+    // Window on entry
+    int32_t alpha = 0;
+    int32_t beta = 0;
+    int32_t score = 0;
+    // Packed move leading to node (from | to << 6)
+    uint16_t move = 0u;
+    // Moves searched, including the one causing cutoff
+    uint16_t moves = 0u;
+    uint8_t ply = 0u;
+    uint8_t depth = 0u;
+    TraceNode type = TraceNode::LEAF;
+    // Index of move causing cutoff, NO_CUTOFF if there was none
+    uint8_t cutoffIndex = NO_CUTOFF;
+
+    static constexpr uint8_t NO_CUTOFF = 0xFFu;
+};
+
+static_assert(sizeof(TraceRecord) == 24u, "Trace record layout is part of file format");
+
+class SearchTrace {
+public:
+    static constexpr size_t CHUNK_RECORDS = 4096u;
+    static constexpr size_t CHUNKS_PER_THREAD = 4u;
+
+    // Ring of chunks of one search thread
+    class Buffer {
+    public:
+        void record(const TraceRecord& r)
+        {
+            auto& chunk = _chunks[_current];
+            chunk.records[chunk.count++] = r;
+            if (chunk.count == CHUNK_RECORDS) {
+                _trace.submit(*this);
+            }
+        }
+
+    private:
+        friend class SearchTrace;
+
+        struct Chunk {
+            std::array<TraceRecord, CHUNK_RECORDS> records;
+            uint32_t count = 0u;
+            // Queued for writing, guarded by trace mutex
+            bool writing = false;
+        };
+
+        SearchTrace& _trace;
+        const uint32_t _thread;
+        std::array<Chunk, CHUNKS_PER_THREAD> _chunks;
+        size_t _current = 0u;
+
+        Buffer(SearchTrace& trace, uint32_t thread)
+            : _trace(trace)
+            , _thread(thread)
+        {
+        }
+    };
+
+    // Throws if file cannot be created
+    explicit SearchTrace(const std::string& path);
+
+    SearchTrace(const SearchTrace&) = delete;
+    SearchTrace& operator=(const SearchTrace&) = delete;
+    // Writes remaining records, searches using trace must be finished
+    ~SearchTrace();
+
+    // Buffer of calling thread
+    Buffer& buffer();
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t recordSize;
+        uint32_t reserved;
+    };
+
+    std::FILE* _file;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<Buffer>>> _buffers;
+    // Thread index and chunk
+    std::deque<std::pair<uint32_t, Buffer::Chunk*>> _queue;
+    bool _quit = false;
+    std::mutex _mutex;
+    std::condition_variable _chunkQueued;
+    std::condition_variable _chunkWritten;
+    std::thread _writer;
+
+    // Queues current chunk of buffer and moves it to next one, waits if the ring is full
+    void submit(Buffer& buffer);
+    void write();
+};
+
+// Trace used by searches unless set otherwise, nullptr by default
+SearchTrace* defaultTrace();
+void setDefaultTrace(SearchTrace* trace);
@@ -0,0 +1,201 @@
+#include "server.hpp"
+#include "ai.hpp"
+#include "board_stats.hpp"
+#include "fen.hpp"
+#include "game_end.hpp"
+#include "notation.hpp"
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// Nodes searched before other games get the thread
+constexpr auto SLICE_NODES = 20000u;
+
+struct Game {
+    Board board;
+    BoardStats boardStats;
+    Color color = Color::WHITE;
+    // Game is owned by a search job, no other command can touch it
+    std::atomic_bool searching = false;
+
+    explicit Game(Position position)
+        : board(std::move(position.board))
+        , color(position.color)
+    {
+        boardStats.visit(board);
+    }
+
+    void play(const Move& m)
+    {
+        board.applyMove(m);
+        board.clearUndoMoves();
+        boardStats.visit(board);
+        color = enemyColor(color);
+    }
+};
+
+class Server {
+public:
+    explicit Server(const ServerConfig& config)
+        : _config(config)
+        , _scheduler(threads(config), SLICE_NODES)
+    {
+    }
+
+    void run()
+    {
+        for (std::string line; std::getline(std::cin, line);) {
+            std::istringstream is(line);
+            std::string command, id;
+            is >> command >> id;
+
+            if (command.empty()) {
+                continue;
+            }
+            if (command == "quit") {
+                break;
+            }
+            try {
+                execute(command, id, is);
+            } catch (const std::exception& ex) {
+                reply("error " + id + " " + ex.what());
+            }
+        }
+        _scheduler.wait();
+    }
+
+private:
+    const ServerConfig& _config;
+    std::unordered_map<std::string, std::unique_ptr<Game>> _games;
+    std::mutex _outputMutex;
+    // Destroyed first, running searches reference games and output
+    SearchScheduler _scheduler;
+
+    static size_t threads(const ServerConfig& config)
+    {
+        return config.threads > 0u ? config.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    static std::string errorMessage(std::exception_ptr error)
+    {
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& ex) {
+            return ex.what();
+        } catch (...) {
+            return "search failed";
+        }
+    }
+
+    void reply(const std::string& str)
+    {
+        std::lock_guard<std::mutex> lock(_outputMutex);
+        std::cout << str << std::endl;
+    }
+
+    Game& game(const std::string& id)
+    {
+        const auto it = _games.find(id);
+        if (it == _games.end()) {
+            throw std::runtime_error("unknown game");
+        }
+        if (it->second->searching) {
+            throw std::runtime_error("game is searching");
+        }
+        return *it->second;
+    }
+
+    void execute(const std::string& command, const std::string& id, std::istringstream& args)
+    {
+        if (id.empty()) {
+            throw std::runtime_error("missing game id");
+        }
+        if (command == "new") {
+            std::string fen;
+            std::getline(args >> std::ws, fen);
+            if (_games.count(id) > 0u) {
+                throw std::runtime_error("game already exists");
+            }
+            _games[id] = std::make_unique<Game>(parseFen(fen.empty() ? STARTING_FEN : fen));
+            reply("ok new " + id);
+        } else if (command == "move") {
+            auto& g = game(id);
+            std::string str;
+            args >> str;
+            const auto m = findMove(g.board, g.color, str);
+            if (!m) {
+                throw std::runtime_error("invalid move " + str);
+            }
+            // Generated moves are pseudo legal, own king must not be left in check
+            bool legal = false;
+            if (castlingAllowed(g.board, g.color, *m, g.board.kingInCheck(g.color))) {
+                const auto undos = g.board.applyMove(*m);
+                legal = !g.board.kingInCheck(g.color);
+                g.board.undoMove(undos);
+            }
+            if (!legal) {
+                throw std::runtime_error("illegal move " + str);
+            }
+            g.play(*m);
+            reply("ok move " + id);
+        } else if (command == "go") {
+            size_t moveTime = _config.moveTime;
+            size_t depth = 0u;
+            size_t priority = 1u;
+            args >> moveTime >> depth >> priority;
+            go(id, game(id), moveTime, depth, priority);
+        } else if (command == "fen") {
+            const auto& g = game(id);
+            reply("fen " + id + " " + toFen(g.board, g.color));
+        } else if (command == "delete") {
+            game(id);
+            _games.erase(id);
+            reply("ok delete " + id);
+        } else {
+            throw std::runtime_error("unknown command " + command);
+        }
+    }
+
+    void go(const std::string& id, Game& g, size_t moveTime, size_t depth, size_t priority)
+    {
+        g.searching = true;
+        auto ai = std::make_shared<AI>(g.board, g.color, g.boardStats);
+        // Time budget starts with the command, searches share threads instead of waiting for them
+        const auto deadline = AI::Clock::now() + std::chrono::milliseconds(moveTime);
+        ai->setDeadline(deadline);
+        if (depth > 0u) {
+            ai->setMaxDepth(depth);
+        }
+        _scheduler.submit(ai->search(_scheduler.sliceNodes()), priority, deadline, [this, id, &g, ai](std::exception_ptr error) {
+            const auto m = ai->bestMove();
+            std::ostringstream os;
+            if (error) {
+                os << "error " << id << ' ' << errorMessage(error);
+            } else if (m) {
+                g.play(*m);
+                os << "bestmove " << id << ' ' << *m << " score " << *ai->bestScore() << " nodes " << ai->nodes();
+            } else {
+                os << "error " << id << " no move available";
+            }
+            g.searching = false;
+            reply(os.str());
+        });
+    }
+};
+
+} // namespace
+
+void runServer(const ServerConfig& config)
+{
+    Server server(config);
+    server.run();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+struct ServerConfig {
+    // Search threads shared by all games, zero means all cores
+    size_t threads = 0u;
+    // Default search time per move in milliseconds
+    size_t moveTime = 2000u;
+};
+
+// Plays many independent games over line protocol on stdin/stdout
+//   new <id> [fen]              create game, starting position by default
+//   move <id> <move>            apply opponent's move in coordinate notation
+//   go <id> [movetime] [depth] [priority]
+//                               search on shared threads and play best move, searches of all games
+//                               are interleaved, higher priority gets proportionally more time
+//   fen <id>                    print position
+//   delete <id>                 drop game
+//   quit                        finish pending searches and exit
+// Replies are "ok <command> <id>", "bestmove <id> <move> score <score> nodes <nodes>",
+// "fen <id> <fen>" or "error <id> <message>", searches reply asynchronously
+void runServer(const ServerConfig& config);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "figures.hpp"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Masks of 64 square array, bit index is square position (y * 8 + x)
+// All squares are compared at once by AVX2 (two 32 byte lanes) or SSE2 (four 16 byte lanes),
+// scalar loop is the fallback. Squares of a mask are visited by countr_zero and clearing the lowest bit
+
+// Squares whose bits selected by mask equal value
+inline uint64_t squareMask(const std::array<Square, 64u>& squares, Square mask, Square value)
+{
+    uint64_t result = 0u;
+#if defined(__AVX2__)
+    const auto m = _mm256_set1_epi8(static_cast<char>(mask));
+    const auto v = _mm256_set1_epi8(static_cast<char>(value));
+    for (size_t i = 0u; i < squares.size(); i += 32u) {
+        const auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(squares.data() + i));
+        const auto eq = _mm256_cmpeq_epi8(_mm256_and_si256(s, m), v);
+        result |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(eq))) << i;
+    }
+#elif defined(__SSE2__)
+    const auto m = _mm_set1_epi8(static_cast<char>(mask));
+    const auto v = _mm_set1_epi8(static_cast<char>(value));
+    for (size_t i = 0u; i < squares.size(); i += 16u) {
+        const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(squares.data() + i));
+        const auto eq = _mm_cmpeq_epi8(_mm_and_si128(s, m), v);
+        result |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(eq))) << i;
+    }
+#else
+    for (size_t i = 0u; i < squares.size(); i++) {
+        result |= static_cast<uint64_t>((squares[i] & mask) == value) << i;
+    }
+#endif
+    return result;
+}
+
+// Squares with a figure of any color
+inline uint64_t occupiedMask(const std::array<Square, 64u>& squares)
+{
+    return ~squareMask(squares, 0x0F, static_cast<Square>(Figure::NONE));
+}
+
+// Squares with a figure of color c
+inline uint64_t colorMask(const std::array<Square, 64u>& squares, Color c)
+{
+    // Color is bit 4 of square
+    return occupiedMask(squares) & squareMask(squares, 0x10, static_cast<Square>(static_cast<Square>(c) << 4));
+}
@@ -0,0 +1,410 @@
+#include "tablebase.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tablebase {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'M', 'C', 'E', 'T', 'B', '0', '0', '1' };
+constexpr size_t HEADER_SIZE = 64u;
+constexpr size_t SIGNATURE_SIZE = 16u;
+constexpr char KIND_CHARS[] = "PNBRQK";
+// White king is mirrored to files a-d
+constexpr size_t KING_SQUARES = 32u;
+
+const Tablebases* tablebases = nullptr;
+
+struct Header {
+    char magic[8];
+    uint32_t figures;
+    char signature[SIGNATURE_SIZE];
+};
+
+Kind kind(Figure f)
+{
+    switch (f) {
+    case Figure::PAWN:
+    case Figure::PAWN_IDLE:
+    case Figure::PAWN_EN_PASSANT:
+        return Kind::PAWN;
+    case Figure::KNIGHT:
+        return Kind::KNIGHT;
+    case Figure::BISHOP:
+        return Kind::BISHOP;
+    case Figure::ROOK:
+    case Figure::ROOK_IDLE:
+        return Kind::ROOK;
+    case Figure::QUEEN:
+        return Kind::QUEEN;
+    default:
+        return Kind::KING;
+    }
+}
+
+std::vector<Kind> figureKinds(const Position& p, Color c)
+{
+    std::vector<Kind> kinds;
+    for (size_t i = 0u; i < p.count; i++) {
+        if (p.pieces[i].color == c && p.pieces[i].kind != Kind::KING) {
+            kinds.push_back(p.pieces[i].kind);
+        }
+    }
+    std::sort(kinds.rbegin(), kinds.rend());
+    return kinds;
+}
+
+std::string signatureName(const std::vector<Kind>& white, const std::vector<Kind>& black)
+{
+    std::string name = "K";
+    for (const auto k : white) {
+        name += KIND_CHARS[static_cast<size_t>(k)];
+    }
+    name += 'K';
+    for (const auto k : black) {
+        name += KIND_CHARS[static_cast<size_t>(k)];
+    }
+    return name;
+}
+
+// Kings first, then white and black figures, strongest first
+int canonicalOrder(const Piece& p)
+{
+    if (p.kind == Kind::KING) {
+        return static_cast<int>(p.color);
+    }
+    return 2 + static_cast<int>(p.color) * 6 + (static_cast<int>(Kind::QUEEN) - static_cast<int>(p.kind));
+}
+
+size_t dtmFileSize(const Signature& s)
+{
+    return HEADER_SIZE + s.size();
+}
+
+size_t wdlFileSize(const Signature& s)
+{
+    return HEADER_SIZE + (s.size() + 3u) / 4u;
+}
+
+void writeFile(const std::string& path, const Signature& s, const std::vector<uint8_t>& data)
+{
+    std::ofstream os(path, std::ios::binary);
+    if (!os) {
+        throw std::runtime_error("Tablebase - unable to create " + path);
+    }
+    char header[HEADER_SIZE] = {};
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    const auto figures = static_cast<uint32_t>(s.figures());
+    std::memcpy(header + offsetof(Header, figures), &figures, sizeof(figures));
+    std::memcpy(header + offsetof(Header, signature), s.name.data(), std::min(s.name.size(), SIGNATURE_SIZE));
+
+    os.write(header, sizeof(header));
+    os.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!os) {
+        throw std::runtime_error("Tablebase - unable to write " + path);
+    }
+}
+
+// Mapping of missing file is empty
+template <typename Mapping>
+Mapping mapFile(const std::string& path, const Signature& s, size_t expectedSize)
+{
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Mapping {};
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != expectedSize) {
+        ::close(fd);
+        throw std::runtime_error("Tablebase - invalid table size " + path);
+    }
+    auto* mapping = ::mmap(nullptr, expectedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Tablebase - unable to map " + path);
+    }
+    // Search probes are scattered over whole table
+    ::madvise(mapping, expectedSize, MADV_RANDOM);
+
+    Header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.figures != s.figures()
+        || s.name.compare(0u, SIGNATURE_SIZE, header.signature, strnlen(header.signature, SIGNATURE_SIZE)) != 0) {
+        ::munmap(mapping, expectedSize);
+        throw std::runtime_error("Tablebase - incompatible table " + path);
+    }
+    return Mapping { static_cast<const unsigned char*>(mapping), expectedSize };
+}
+
+} // namespace
+
+size_t Signature::size() const
+{
+    size_t size = 2u * KING_SQUARES;
+    for (size_t i = 1u; i < figures(); i++) {
+        size *= static_cast<size_t>(Board::SIZE);
+    }
+    return size;
+}
+
+Signature parseSignature(const std::string& name)
+{
+    Signature s;
+    s.name = name;
+    std::vector<Kind>* side = nullptr;
+
+    for (const auto ch : name) {
+        const auto* kindChar = std::strchr(KIND_CHARS, ch);
+        if (ch == '\0' || !kindChar) {
+            throw std::runtime_error("Tablebase - invalid signature " + name);
+        }
+        const auto k = static_cast<Kind>(kindChar - KIND_CHARS);
+        if (k == Kind::KING) {
+            side = side ? &s.black : &s.white;
+            continue;
+        }
+        if (!side) {
+            throw std::runtime_error("Tablebase - invalid signature " + name);
+        }
+        side->push_back(k);
+    }
+    const auto sorted = [](const auto& kinds) {
+        return std::is_sorted(kinds.rbegin(), kinds.rend());
+    };
+    if (side != &s.black || s.figures() > MAX_FIGURES || !sorted(s.white) || !sorted(s.black)
+        || std::lexicographical_compare(s.white.begin(), s.white.end(), s.black.begin(), s.black.end())) {
+        throw std::runtime_error("Tablebase - invalid signature " + name);
+    }
+    return s;
+}
+
+Canonical canonicalize(const Position& p)
+{
+    auto white = figureKinds(p, Color::WHITE);
+    auto black = figureKinds(p, Color::BLACK);
+    const auto swap = std::lexicographical_compare(white.begin(), white.end(), black.begin(), black.end());
+    if (swap) {
+        std::swap(white, black);
+    }
+
+    Canonical c;
+    c.name = signatureName(white, black);
+    c.position = p;
+    auto& pieces = c.position.pieces;
+
+    if (swap) {
+        c.position.sideToMove = enemyColor(p.sideToMove);
+        for (size_t i = 0u; i < p.count; i++) {
+            pieces[i].color = enemyColor(pieces[i].color);
+            pieces[i].pos ^= 56;
+        }
+    }
+    std::stable_sort(pieces.begin(), pieces.begin() + p.count, [](const auto& a, const auto& b) {
+        return canonicalOrder(a) < canonicalOrder(b);
+    });
+    if (pieces[0].pos % Board::WIDTH >= Board::WIDTH / 2) {
+        for (size_t i = 0u; i < p.count; i++) {
+            pieces[i].pos ^= 7;
+        }
+    }
+    return c;
+}
+
+size_t index(const Position& p)
+{
+    const auto king = p.pieces[0].pos;
+    auto idx = static_cast<size_t>(p.sideToMove) * KING_SQUARES + (king / Board::WIDTH) * (Board::WIDTH / 2) + king % Board::WIDTH;
+    for (size_t i = 1u; i < p.count; i++) {
+        idx = idx * Board::SIZE + p.pieces[i].pos;
+    }
+    return idx;
+}
+
+Position decode(const Signature& s, size_t index)
+{
+    Position p;
+    p.count = s.figures();
+    p.pieces[0] = { Kind::KING, Color::WHITE, 0 };
+    p.pieces[1] = { Kind::KING, Color::BLACK, 0 };
+    size_t i = 2u;
+    for (const auto k : s.white) {
+        p.pieces[i++] = { k, Color::WHITE, 0 };
+    }
+    for (const auto k : s.black) {
+        p.pieces[i++] = { k, Color::BLACK, 0 };
+    }
+
+    for (i = p.count - 1u; i > 0u; i--) {
+        p.pieces[i].pos = static_cast<int>(index % Board::SIZE);
+        index /= Board::SIZE;
+    }
+    const auto king = static_cast<int>(index % KING_SQUARES);
+    p.pieces[0].pos = (king / (Board::WIDTH / 2)) * Board::WIDTH + king % (Board::WIDTH / 2);
+    p.sideToMove = static_cast<Color>(index / KING_SQUARES);
+    return p;
+}
+
+Result decodeDtm(uint8_t dtm)
+{
+    if (dtm == DTM_ILLEGAL) {
+        return Result { Wdl::ILLEGAL, 0u };
+    }
+    if (dtm >= DTM_LOSS) {
+        return Result { Wdl::LOSS, static_cast<size_t>(dtm - DTM_LOSS) };
+    }
+    if (dtm != DTM_DRAW) {
+        return Result { Wdl::WIN, dtm };
+    }
+    return Result { Wdl::DRAW, 0u };
+}
+
+void writeTable(const std::string& dir, const Signature& s, const std::vector<uint8_t>& dtm)
+{
+    std::vector<uint8_t> wdl((s.size() + 3u) / 4u, 0u);
+    for (size_t i = 0u; i < dtm.size(); i++) {
+        const auto value = static_cast<uint8_t>(decodeDtm(dtm[i]).wdl);
+        wdl[i / 4u] |= value << ((i % 4u) * 2u);
+    }
+    writeFile(dir + "/" + s.name + ".dtm", s, dtm);
+    writeFile(dir + "/" + s.name + ".wdl", s, wdl);
+}
+
+std::unique_ptr<Tablebases> Tablebases::load(const std::string& dir)
+{
+    if (!std::filesystem::is_directory(dir)) {
+        throw std::runtime_error("Tablebase - no directory " + dir);
+    }
+    std::unique_ptr<Tablebases> tbs(new Tablebases());
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        const auto extension = entry.path().extension();
+        if (extension != ".dtm" && extension != ".wdl") {
+            continue;
+        }
+        const auto name = entry.path().stem().string();
+        if (tbs->_tables.count(name)) {
+            continue;
+        }
+        auto& table = tbs->_tables[name];
+        table.signature = parseSignature(name);
+        const auto base = dir + "/" + name;
+        table.dtm = mapFile<Mapping>(base + ".dtm", table.signature, dtmFileSize(table.signature));
+        table.wdl = mapFile<Mapping>(base + ".wdl", table.signature, wdlFileSize(table.signature));
+    }
+    return tbs;
+}
+
+Tablebases::~Tablebases()
+{
+    for (const auto& [name, table] : _tables) {
+        for (const auto& mapping : { table.dtm, table.wdl }) {
+            if (mapping.data) {
+                ::munmap(const_cast<unsigned char*>(mapping.data), mapping.size);
+            }
+        }
+    }
+}
+
+std::optional<Result> Tablebases::probe(const Position& p) const
+{
+    if (p.count == 2u) {
+        return Result { Wdl::DRAW, 0u };
+    }
+    const auto c = canonicalize(p);
+    const auto it = _tables.find(c.name);
+    if (it == _tables.end()) {
+        return std::nullopt;
+    }
+    const auto idx = index(c.position);
+    const auto& table = it->second;
+
+    if (table.dtm.data) {
+        return decodeDtm(table.dtm.data[HEADER_SIZE + idx]);
+    }
+    const auto wdl = (table.wdl.data[HEADER_SIZE + idx / 4u] >> ((idx % 4u) * 2u)) & 3u;
+    return Result { static_cast<Wdl>(wdl), 0u };
+}
+
+std::optional<Result> Tablebases::probe(const Board& b, Color c) const
+{
+    if (static_cast<size_t>(b.figureCount()) > MAX_FIGURES) {
+        return std::nullopt;
+    }
+    Position p;
+    p.sideToMove = c;
+    std::array<size_t, 2u> kings = { 0u, 0u };
+
+    for (auto figures = occupiedMask(b.squares()); figures != 0u; figures &= figures - 1u) {
+        const auto pos = std::countr_zero(figures);
+        const auto sq = b.get(pos);
+        const auto fig = figure(sq);
+        const auto col = color(sq);
+        const auto x = pos % Board::WIDTH;
+        const auto y = pos / Board::WIDTH;
+
+        // Castling rights
+        if (fig == Figure::KING_IDLE && (b.get(0, y) == square(Figure::ROOK_IDLE, col) || b.get(Board::WIDTH - 1, y) == square(Figure::ROOK_IDLE, col))) {
+            return std::nullopt;
+        }
+        // En passant capture
+        if (fig == Figure::PAWN_EN_PASSANT && col != c) {
+            for (int i = -1; i <= 1; i += 2) {
+                const auto neighbour = Board::validIndex(x + i, y) ? b.get(x + i, y) : EMPTY_SQUARE;
+                if (color(neighbour) == c && kind(figure(neighbour)) == Kind::PAWN) {
+                    return std::nullopt;
+                }
+            }
+        }
+        const auto k = kind(fig);
+        if (k == Kind::KING) {
+            kings[static_cast<size_t>(col)]++;
+        }
+        p.pieces[p.count++] = Piece { k, col, pos };
+    }
+    if (kings[0] != 1u || kings[1] != 1u) {
+        return std::nullopt;
+    }
+    return probe(p);
+}
+
+std::optional<int> Tablebases::score(const Board& b, Color c) const
+{
+    const auto result = probe(b, c);
+    if (!result) {
+        return std::nullopt;
+    }
+    switch (result->wdl) {
+    case Wdl::WIN:
+        return WIN_SCORE - static_cast<int>(result->dtm);
+    case Wdl::LOSS:
+        return -(WIN_SCORE - static_cast<int>(result->dtm));
+    case Wdl::DRAW:
+        return 0;
+    default:
+        // Side to move can capture king, search resolves it
+        return std::nullopt;
+    }
+}
+
+const Tablebases* defaultTablebases()
+{
+    return tablebases;
+}
+
+void setDefaultTablebases(const Tablebases* tbs)
+{
+    tablebases = tbs;
+}
+
+} // namespace tablebase
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Endgame tablebases of positions with up to 4 figures, generated by mce_tbgen
+//
+// Every table covers one material signature with stronger side as white (e.g. KQKR), positions
+// where black is stronger are probed with colors swapped and ranks flipped. Castling and en passant
+// are not part of tables, promotion is always to queen as in the engine.
+//
+// Position index is built from side to move, white king square mirrored to files a-d, black king
+// square and squares of white and black figures in signature order. Files are memory mapped as is:
+//   header   64 B, "MCETB001", uint32 number of figures, signature, zero padding
+//   .dtm     uint8 per position, 0 draw, 1-126 win in plies, 128 + plies loss, 255 illegal
+//            (mce_tbgen rejects tables with longer mates, their codes would reach illegal)
+//   .wdl     2 bits per position (lowest bits first), 0 draw, 1 win, 2 loss, 3 illegal
+namespace tablebase {
+
+constexpr size_t MAX_FIGURES = 4u;
+// Score of won position, decreased by plies to mate, so it stays below king capture
+constexpr int WIN_SCORE = 60000;
+
+constexpr uint8_t DTM_DRAW = 0u;
+constexpr uint8_t DTM_MAX = 126u;
+constexpr uint8_t DTM_LOSS = 128u;
+constexpr uint8_t DTM_ILLEGAL = 255u;
+
+enum class Kind : uint8_t {
+    PAWN,
+    KNIGHT,
+    BISHOP,
+    ROOK,
+    QUEEN,
+    KING
+};
+
+struct Piece {
+    Kind kind;
+    Color color;
+    int pos;
+};
+
+struct Position {
+    std::array<Piece, MAX_FIGURES> pieces;
+    size_t count = 0u;
+    Color sideToMove = Color::WHITE;
+};
+
+enum class Wdl : uint8_t {
+    DRAW,
+    WIN,
+    LOSS,
+    ILLEGAL
+};
+
+// Result from side to move's point of view, dtm is 0 if only WDL table is available
+struct Result {
+    Wdl wdl;
+    size_t dtm;
+};
+
+struct Signature {
+    std::string name;
+    // Figures except kings, strongest first
+    std::vector<Kind> white;
+    std::vector<Kind> black;
+
+    size_t figures() const
+    {
+        return 2u + white.size() + black.size();
+    }
+
+    // Number of positions in table
+    size_t size() const;
+};
+
+// Throws if name is not valid signature of stronger side first (e.g. KRKP)
+Signature parseSignature(const std::string& name);
+
+// Signature name, white king, black king, white and black figures in signature order
+// White king is on files a-d and colors are swapped if black is stronger
+struct Canonical {
+    std::string name;
+    Position position;
+};
+
+Canonical canonicalize(const Position& p);
+// Position has to be canonical
+size_t index(const Position& p);
+Position decode(const Signature& s, size_t index);
+
+Result decodeDtm(uint8_t dtm);
+
+// Writes .dtm and .wdl files of table into directory
+void writeTable(const std::string& dir, const Signature& s, const std::vector<uint8_t>& dtm);
+
+class Tablebases {
+public:
+    // Loads every table found in directory
+    static std::unique_ptr<Tablebases> load(const std::string& dir);
+
+    Tablebases(const Tablebases&) = delete;
+    Tablebases& operator=(const Tablebases&) = delete;
+    ~Tablebases();
+
+    // nullopt if material has no table, bare kings are always draw
+    std::optional<Result> probe(const Position& p) const;
+    // nullopt also if castling or en passant capture is possible
+    std::optional<Result> probe(const Board& b, Color c) const;
+    // Search score of side to move, win distance is counted from probed position
+    std::optional<int> score(const Board& b, Color c) const;
+
+    size_t size() const
+    {
+        return _tables.size();
+    }
+
+private:
+    struct Mapping {
+        const unsigned char* data = nullptr;
+        size_t size = 0u;
+    };
+
+    struct Table {
+        Signature signature;
+        Mapping dtm;
+        Mapping wdl;
+    };
+
+    std::map<std::string, Table> _tables;
+
+    Tablebases() = default;
+};
+
+// Tablebases probed by newly created AIs, nullptr disables probing
+const Tablebases* defaultTablebases();
+void setDefaultTablebases(const Tablebases* tablebases);
+
+} // namespace tablebase
@@ -0,0 +1,566 @@
+#include "tablebase.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+
+using namespace tablebase;
+
+namespace {
+
+// Value of position which is not resolved yet, never written into table
+constexpr uint8_t UNKNOWN = 127u;
+constexpr size_t CHUNK_SIZE = 1u << 16u;
+
+constexpr int KNIGHT_OFFSETS[8][2] = { { 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 } };
+constexpr int KING_OFFSETS[8][2] = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+// Straight directions first, then diagonal ones
+constexpr int RAYS[8][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 }, { 1, 1 }, { -1, 1 }, { -1, -1 }, { 1, -1 } };
+
+using Occupancy = std::array<int8_t, 64u>;
+
+Occupancy occupancy(const Position& p)
+{
+    Occupancy occ;
+    occ.fill(-1);
+    for (size_t i = 0u; i < p.count; i++) {
+        occ[p.pieces[i].pos] = static_cast<int8_t>(i);
+    }
+    return occ;
+}
+
+int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+bool pathClear(int from, int to, const Occupancy& occ)
+{
+    const auto dx = sign(to % Board::WIDTH - from % Board::WIDTH);
+    const auto dy = sign(to / Board::WIDTH - from / Board::WIDTH);
+    for (auto pos = from + dy * Board::WIDTH + dx; pos != to; pos += dy * Board::WIDTH + dx) {
+        if (occ[pos] >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool attacks(const Piece& piece, int target, const Occupancy& occ)
+{
+    const auto dx = target % Board::WIDTH - piece.pos % Board::WIDTH;
+    const auto dy = target / Board::WIDTH - piece.pos / Board::WIDTH;
+    const auto adx = std::abs(dx);
+    const auto ady = std::abs(dy);
+    const auto straight = (dx == 0) != (dy == 0);
+    const auto diagonal = adx == ady && adx != 0;
+
+    switch (piece.kind) {
+    case Kind::PAWN:
+        return adx == 1 && dy == (piece.color == Color::WHITE ? 1 : -1);
+    case Kind::KNIGHT:
+        return (adx == 1 && ady == 2) || (adx == 2 && ady == 1);
+    case Kind::BISHOP:
+        return diagonal && pathClear(piece.pos, target, occ);
+    case Kind::ROOK:
+        return straight && pathClear(piece.pos, target, occ);
+    case Kind::QUEEN:
+        return (straight || diagonal) && pathClear(piece.pos, target, occ);
+    default:
+        return std::max(adx, ady) == 1;
+    }
+}
+
+bool attacked(const Position& p, const Occupancy& occ, int target, Color by)
+{
+    for (size_t i = 0u; i < p.count; i++) {
+        if (p.pieces[i].color == by && attacks(p.pieces[i], target, occ)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int kingSquare(const Position& p, Color c)
+{
+    for (size_t i = 0u; i < p.count; i++) {
+        if (p.pieces[i].kind == Kind::KING && p.pieces[i].color == c) {
+            return p.pieces[i].pos;
+        }
+    }
+    return -1;
+}
+
+bool inCheck(const Position& p)
+{
+    return attacked(p, occupancy(p), kingSquare(p, p.sideToMove), enemyColor(p.sideToMove));
+}
+
+bool legal(const Position& p)
+{
+    const auto occ = occupancy(p);
+    for (size_t i = 0u; i < p.count; i++) {
+        const auto& piece = p.pieces[i];
+        if (occ[piece.pos] != static_cast<int8_t>(i)) {
+            return false;
+        }
+        const auto y = piece.pos / Board::WIDTH;
+        if (piece.kind == Kind::PAWN && (y == 0 || y == Board::HEIGHT - 1)) {
+            return false;
+        }
+    }
+    // Side to move cannot capture king
+    return !attacked(p, occ, kingSquare(p, enemyColor(p.sideToMove)), p.sideToMove);
+}
+
+template <typename Fn>
+void forEachTarget(const Piece& piece, const Occupancy& occ, bool quietOnly, Fn&& f)
+{
+    const auto x = piece.pos % Board::WIDTH;
+    const auto y = piece.pos / Board::WIDTH;
+
+    const auto step = [&](const int(&offsets)[8][2]) {
+        for (const auto& o : offsets) {
+            if (Board::validIndex(x + o[0], y + o[1])) {
+                f((y + o[1]) * Board::WIDTH + x + o[0]);
+            }
+        }
+    };
+    const auto slide = [&](size_t first, size_t last) {
+        for (auto r = first; r < last; r++) {
+            for (int tx = x + RAYS[r][0], ty = y + RAYS[r][1]; Board::validIndex(tx, ty); tx += RAYS[r][0], ty += RAYS[r][1]) {
+                const auto to = ty * Board::WIDTH + tx;
+                if (occ[to] >= 0) {
+                    if (!quietOnly) {
+                        f(to);
+                    }
+                    break;
+                }
+                f(to);
+            }
+        }
+    };
+
+    switch (piece.kind) {
+    case Kind::KNIGHT:
+        step(KNIGHT_OFFSETS);
+        break;
+    case Kind::BISHOP:
+        slide(4u, 8u);
+        break;
+    case Kind::ROOK:
+        slide(0u, 4u);
+        break;
+    case Kind::QUEEN:
+        slide(0u, 8u);
+        break;
+    case Kind::KING:
+        step(KING_OFFSETS);
+        break;
+    default:
+        break;
+    }
+}
+
+// Calls f(child, exit) for every legal move, exit child has other material (capture or promotion)
+template <typename Fn>
+void forEachMove(const Position& p, Fn&& f)
+{
+    const auto occ = occupancy(p);
+    const auto us = p.sideToMove;
+
+    for (size_t i = 0u; i < p.count; i++) {
+        const auto& piece = p.pieces[i];
+        if (piece.color != us) {
+            continue;
+        }
+        const auto play = [&](int to) {
+            Position child = p;
+            auto moving = i;
+            auto exit = false;
+            if (occ[to] >= 0) {
+                const auto captured = static_cast<size_t>(occ[to]);
+                if (p.pieces[captured].color == us || p.pieces[captured].kind == Kind::KING) {
+                    return;
+                }
+                std::copy(child.pieces.begin() + captured + 1u, child.pieces.begin() + child.count, child.pieces.begin() + captured);
+                child.count--;
+                moving -= captured < moving ? 1u : 0u;
+                exit = true;
+            }
+            auto& moved = child.pieces[moving];
+            moved.pos = to;
+            if (moved.kind == Kind::PAWN && (to / Board::WIDTH == 0 || to / Board::WIDTH == Board::HEIGHT - 1)) {
+                moved.kind = Kind::QUEEN;
+                exit = true;
+            }
+            child.sideToMove = enemyColor(us);
+            if (attacked(child, occupancy(child), kingSquare(child, us), child.sideToMove)) {
+                return;
+            }
+            f(child, exit);
+        };
+
+        if (piece.kind != Kind::PAWN) {
+            forEachTarget(piece, occ, false, play);
+            continue;
+        }
+        const auto x = piece.pos % Board::WIDTH;
+        const auto y = piece.pos / Board::WIDTH;
+        const auto dir = us == Color::WHITE ? 1 : -1;
+        const auto start = us == Color::WHITE ? 1 : Board::HEIGHT - 2;
+        const auto forward = piece.pos + dir * Board::WIDTH;
+        if (occ[forward] < 0) {
+            play(forward);
+            if (y == start && occ[forward + dir * Board::WIDTH] < 0) {
+                play(forward + dir * Board::WIDTH);
+            }
+        }
+        for (int side = -1; side <= 1; side += 2) {
+            if (Board::validIndex(x + side, y + dir) && occ[forward + side] >= 0) {
+                play(forward + side);
+            }
+        }
+    }
+}
+
+// Calls f(parent) for every position with same material, other side to move, leading to p
+template <typename Fn>
+void forEachUnmove(const Position& p, Fn&& f)
+{
+    const auto occ = occupancy(p);
+    const auto them = enemyColor(p.sideToMove);
+
+    for (size_t i = 0u; i < p.count; i++) {
+        const auto& piece = p.pieces[i];
+        if (piece.color != them) {
+            continue;
+        }
+        const auto unplay = [&](int from) {
+            if (occ[from] >= 0) {
+                return;
+            }
+            Position parent = p;
+            parent.pieces[i].pos = from;
+            parent.sideToMove = them;
+            f(parent);
+        };
+
+        if (piece.kind != Kind::PAWN) {
+            forEachTarget(piece, occ, true, unplay);
+            continue;
+        }
+        const auto y = piece.pos / Board::WIDTH;
+        const auto dir = them == Color::WHITE ? 1 : -1;
+        const auto start = them == Color::WHITE ? 1 : Board::HEIGHT - 2;
+        const auto back = piece.pos - dir * Board::WIDTH;
+        // Pawn on start rank has not moved yet
+        if (y == start || occ[back] >= 0) {
+            continue;
+        }
+        unplay(back);
+        if (y == start + 2 * dir) {
+            unplay(back - dir * Board::WIDTH);
+        }
+    }
+}
+
+uint8_t winCode(size_t dtm)
+{
+    return static_cast<uint8_t>(std::min<size_t>(dtm, DTM_MAX));
+}
+
+uint8_t lossCode(size_t dtm)
+{
+    return static_cast<uint8_t>(DTM_LOSS + std::min<size_t>(dtm, DTM_MAX));
+}
+
+// Retrograde analysis of one table
+//
+// Initial pass resolves mates, stalemates and positions decided by captures and promotions into
+// already generated tables. Then positions are processed by increasing distance to mate,
+// predecessors of lost positions are won and predecessors of won positions are lost once all their
+// moves lead to final wins. Values up to processed distance are final, so distances are exact.
+class Generator {
+public:
+    Generator(const Signature& s, const Tablebases& tablebases, ThreadPool& pool)
+        : _signature(s)
+        , _tablebases(tablebases)
+        , _pool(pool)
+        , _values(new std::atomic<uint8_t>[s.size()])
+    {
+    }
+
+    std::vector<uint8_t> run()
+    {
+        parallelFor([this](size_t idx) {
+            const auto p = decode(_signature, idx);
+            const auto value = legal(p) ? resolve(p, std::nullopt) : DTM_ILLEGAL;
+            _values[idx].store(value, std::memory_order_relaxed);
+            updateMaxDtm(value);
+        });
+        if (_missingTable) {
+            throw std::runtime_error("Tablebase - " + _signature.name + " needs table " + _missingName);
+        }
+
+        for (size_t dtm = 0u; dtm <= _maxDtm; dtm++) {
+            parallelFor([this, dtm](size_t idx) {
+                const auto value = _values[idx].load(std::memory_order_relaxed);
+                if (value == lossCode(dtm)) {
+                    propagateLoss(idx, dtm);
+                } else if (dtm > 0u && value == winCode(dtm)) {
+                    propagateWin(idx, dtm);
+                }
+            });
+        }
+        if (_dtmOverflow) {
+            throw std::runtime_error("Tablebase - " + _signature.name + " has mate longer than " + std::to_string(DTM_MAX) + " plies");
+        }
+
+        std::vector<uint8_t> table(_signature.size());
+        for (size_t idx = 0u; idx < table.size(); idx++) {
+            const auto value = _values[idx].load(std::memory_order_relaxed);
+            table[idx] = value == UNKNOWN ? DTM_DRAW : value;
+        }
+        return table;
+    }
+
+private:
+    const Signature& _signature;
+    const Tablebases& _tablebases;
+    ThreadPool& _pool;
+    std::unique_ptr<std::atomic<uint8_t>[]> _values;
+    std::atomic<size_t> _maxDtm = 0u;
+    std::atomic_bool _missingTable = false;
+    // Distance above DTM_MAX would be stored clamped, table is rejected instead
+    std::atomic_bool _dtmOverflow = false;
+    std::string _missingName;
+    std::mutex _missingMutex;
+
+    template <typename Fn>
+    void parallelFor(Fn&& fn)
+    {
+        const auto size = _signature.size();
+        for (size_t begin = 0u; begin < size; begin += CHUNK_SIZE) {
+            _pool.submit([&fn, begin, size] {
+                for (auto idx = begin; idx < std::min(size, begin + CHUNK_SIZE); idx++) {
+                    fn(idx);
+                }
+            });
+        }
+        _pool.wait();
+    }
+
+    void updateMaxDtm(uint8_t value)
+    {
+        if (value == DTM_ILLEGAL || value == UNKNOWN) {
+            return;
+        }
+        const auto dtm = decodeDtm(value).dtm;
+        auto current = _maxDtm.load();
+        while (dtm > current && !_maxDtm.compare_exchange_weak(current, dtm)) {
+        }
+    }
+
+    // Position in this table after move, white king may have crossed to files e-h
+    size_t childIndex(Position child) const
+    {
+        if (child.pieces[0].pos % Board::WIDTH >= Board::WIDTH / 2) {
+            for (size_t i = 0u; i < child.count; i++) {
+                child.pieces[i].pos ^= 7;
+            }
+        }
+        return index(child);
+    }
+
+    // Children of this table with distance above final one are not resolved yet, none if initial pass
+    uint8_t resolve(const Position& p, std::optional<size_t> finalDtm)
+    {
+        auto anyMove = false;
+        auto allWins = true;
+        auto minLoss = std::numeric_limits<size_t>::max();
+        size_t maxWin = 0u;
+
+        forEachMove(p, [&](const Position& child, bool exit) {
+            anyMove = true;
+            Result r;
+            if (exit) {
+                const auto probed = _tablebases.probe(child);
+                if (!probed) {
+                    reportMissing(child);
+                    allWins = false;
+                    return;
+                }
+                r = *probed;
+            } else {
+                const auto value = finalDtm ? _values[childIndex(child)].load(std::memory_order_relaxed) : UNKNOWN;
+                if (value == UNKNOWN) {
+                    allWins = false;
+                    return;
+                }
+                r = decodeDtm(value);
+                if (r.wdl == Wdl::WIN && r.dtm > *finalDtm) {
+                    allWins = false;
+                    return;
+                }
+            }
+            if (r.wdl == Wdl::LOSS) {
+                minLoss = std::min(minLoss, r.dtm);
+            }
+            if (r.wdl == Wdl::WIN) {
+                maxWin = std::max(maxWin, r.dtm);
+            } else {
+                allWins = false;
+            }
+        });
+
+        if (!anyMove) {
+            return inCheck(p) ? lossCode(0u) : DTM_DRAW;
+        }
+        if (minLoss != std::numeric_limits<size_t>::max()) {
+            return winCode(checkDtm(minLoss + 1u));
+        }
+        return allWins ? lossCode(checkDtm(maxWin + 1u)) : UNKNOWN;
+    }
+
+    // Every predecessor wins in one more ply, shorter win replaces longer one
+    void propagateLoss(size_t idx, size_t dtm)
+    {
+        const auto target = winCode(checkDtm(dtm + 1u));
+        forEachUnmove(decode(_signature, idx), [&](const Position& parent) {
+            auto& value = _values[childIndex(parent)];
+            auto current = value.load(std::memory_order_relaxed);
+            while (current == UNKNOWN || (current > target && current <= DTM_MAX)) {
+                if (value.compare_exchange_weak(current, target, std::memory_order_relaxed)) {
+                    updateMaxDtm(target);
+                    return;
+                }
+            }
+        });
+    }
+
+    // Predecessors whose every move leads to final win are lost
+    void propagateWin(size_t idx, size_t dtm)
+    {
+        forEachUnmove(decode(_signature, idx), [&](const Position& parent) {
+            auto& value = _values[childIndex(parent)];
+            if (value.load(std::memory_order_relaxed) != UNKNOWN) {
+                return;
+            }
+            const auto resolved = resolve(parent, dtm);
+            if (resolved < DTM_LOSS || resolved == UNKNOWN) {
+                return;
+            }
+            auto expected = UNKNOWN;
+            if (value.compare_exchange_strong(expected, resolved, std::memory_order_relaxed)) {
+                updateMaxDtm(resolved);
+            }
+        });
+    }
+
+    size_t checkDtm(size_t dtm)
+    {
+        if (dtm > DTM_MAX) {
+            _dtmOverflow = true;
+        }
+        return dtm;
+    }
+
+    void reportMissing(const Position& child)
+    {
+        std::lock_guard<std::mutex> lock(_missingMutex);
+        _missingTable = true;
+        _missingName = canonicalize(child).name;
+    }
+};
+
+// Every 3 and 4 figure signature, tables are generated after those they depend on,
+// captures lead to less figures and promotions to less pawns
+std::vector<std::string> allSignatures()
+{
+    const std::vector<Kind> kinds = { Kind::QUEEN, Kind::ROOK, Kind::BISHOP, Kind::KNIGHT, Kind::PAWN };
+    std::vector<Signature> signatures;
+
+    for (size_t i = 0u; i < kinds.size(); i++) {
+        signatures.push_back(Signature { "", { kinds[i] }, {} });
+        for (auto j = i; j < kinds.size(); j++) {
+            signatures.push_back(Signature { "", { kinds[i], kinds[j] }, {} });
+            signatures.push_back(Signature { "", { kinds[i] }, { kinds[j] } });
+        }
+    }
+    const auto pawns = [](const Signature& s) {
+        return std::count(s.white.begin(), s.white.end(), Kind::PAWN) + std::count(s.black.begin(), s.black.end(), Kind::PAWN);
+    };
+    std::stable_sort(signatures.begin(), signatures.end(), [&](const auto& a, const auto& b) {
+        return std::make_pair(a.figures(), pawns(a)) < std::make_pair(b.figures(), pawns(b));
+    });
+
+    std::vector<std::string> names;
+    for (const auto& s : signatures) {
+        std::string name = "K";
+        for (const auto k : s.white) {
+            name += "PNBRQ"[static_cast<size_t>(k)];
+        }
+        name += 'K';
+        for (const auto k : s.black) {
+            name += "PNBRQ"[static_cast<size_t>(k)];
+        }
+        names.push_back(name);
+    }
+    return names;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // mce_tbgen <dir> [threads] [signatures...]
+    if (argc < 2) {
+        std::cerr << "usage: mce_tbgen <dir> [threads] [signatures...]" << std::endl;
+        return -1;
+    }
+    try {
+        const std::string dir = argv[1];
+        const auto threads = argc > 2 ? std::stoul(argv[2]) : 0u;
+        std::vector<std::string> names;
+        for (int i = 3; i < argc; i++) {
+            names.emplace_back(argv[i]);
+        }
+        if (names.empty()) {
+            names = allSignatures();
+        }
+
+        const auto numThreads = threads > 0u ? threads : std::max(1u, std::thread::hardware_concurrency());
+        ThreadPool pool(numThreads, numThreads * 4u);
+
+        for (const auto& name : names) {
+            using namespace std::chrono;
+            const auto start = steady_clock::now();
+            const auto signature = parseSignature(name);
+            // Reloaded so previously generated tables can be probed
+            const auto tablebases = Tablebases::load(dir);
+            const auto table = Generator(signature, *tablebases, pool).run();
+            writeTable(dir, signature, table);
+
+            size_t wins = 0u, draws = 0u, losses = 0u, longest = 0u;
+            for (const auto value : table) {
+                const auto r = decodeDtm(value);
+                wins += r.wdl == Wdl::WIN;
+                draws += r.wdl == Wdl::DRAW;
+                losses += r.wdl == Wdl::LOSS;
+                longest = r.wdl == Wdl::ILLEGAL ? longest : std::max(longest, r.dtm);
+            }
+            std::cout << name << " : wins " << wins << ", draws " << draws << ", losses " << losses
+                      << ", longest mate " << longest << " plies, "
+                      << duration_cast<milliseconds>(steady_clock::now() - start).count() << " ms" << std::endl;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "FATAL: " << ex.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,408 @@
+#include "ai.hpp"
+#include "board_stats.hpp"
+#include "book.hpp"
+#include "fen.hpp"
+#include "game_end.hpp"
+#include "notation.hpp"
+#include "pgn.hpp"
+#include "scheduler.hpp"
+#include "tablebase.hpp"
+#include "tt.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Regression tests of engine invariants, run by ctest
+// mce_tests prints every failed check and returns nonzero if there was any
+
+// Allocation counting hook, scheduler tests allocate on worker threads
+namespace {
+
+std::atomic<size_t> allocations = 0u;
+
+// Null if out of memory, aligned_alloc needs size to be multiple of alignment
+void* countedAllocation(size_t size, size_t alignment)
+{
+    allocations++;
+    size = std::max<size_t>(size, 1u);
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    return std::aligned_alloc(alignment, (size + alignment - 1u) / alignment * alignment);
+}
+
+} // namespace
+
+// Array forms call these, so every variant is counted and freed by free()
+void* operator new(size_t size)
+{
+    if (auto* p = countedAllocation(size, alignof(std::max_align_t))) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (auto* p = countedAllocation(size, static_cast<size_t>(alignment))) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+size_t failures = 0u;
+// Directory with generated KQK table, tablebase tests are skipped without it
+std::string tablebaseDir;
+
+void check(bool condition, const std::string& what)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+Position play(const std::string& fen, const std::vector<std::string>& moves)
+{
+    auto p = parseFen(fen);
+    for (const auto& str : moves) {
+        const auto m = findMove(p.board, p.color, str);
+        if (!m) {
+            throw std::runtime_error("Tests - invalid move " + str);
+        }
+        p.board.applyMove(*m);
+        p.board.clearUndoMoves();
+        p.color = enemyColor(p.color);
+    }
+    return p;
+}
+
+int search(Position p, size_t depth, TranspositionTable& table)
+{
+    BoardStats stats;
+    stats.visit(p.board);
+    AI ai(p.board, p.color, stats);
+    ai.setTranspositionTable(&table);
+    ai.setMaxDepth(depth);
+    ai.run();
+    return ai.bestScore().value_or(0);
+}
+
+void mateScoresInTranspositionTable()
+{
+    // White mates by Rh8 once black king is on b8, the mated position is reached at ply 3 or 7
+    const std::string fen = "k7/8/2K5/8/8/8/8/7R w - - 0 1";
+    const auto shortLine = play(fen, { "c6b6", "a8b8", "h1h8" });
+    const auto longLine = play(fen, { "h1h2", "a8b8", "h2h1", "b8a8", "c6b6", "a8b8", "h1h8" });
+    check(shortLine.board == longLine.board && shortLine.color == longLine.color, "move orders reach one position");
+
+    // Mate found at ply 3 of one line is probed at ply 7 of the other
+    TranspositionTable table(1u);
+    const auto key = TranspositionTable::key(shortLine.board, shortLine.color);
+    table.store(key, scoreToTt(-(MATE_SCORE - 3), 3u), 0u, 4u, TranspositionTable::Bound::EXACT);
+    const auto* entry = table.probe(TranspositionTable::key(longLine.board, longLine.color));
+    check(entry && scoreFromTt(entry->score, 7u) == -(MATE_SCORE - 7), "mate score is relative to probing ply");
+    check(scoreFromTt(scoreToTt(123, 5u), 9u) == 123, "other scores are stored as they are");
+
+    // Search reports distance from its root
+    TranspositionTable searchTable(1u);
+    const auto score = search(parseFen(fen), 6u, searchTable);
+    check(score == MATE_SCORE - 3, "mate in two is found, score " + std::to_string(score));
+}
+
+void polyglotKeys()
+{
+    // Test positions published with Polyglot book format
+    const std::string start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    const std::vector<std::pair<std::vector<std::string>, uint64_t>> positions = {
+        { {}, 0x463B96181691FC9Cull },
+        { { "e2e4" }, 0x823C9B50FD114196ull },
+        { { "e2e4", "d7d5" }, 0x0756B94461C50FB0ull },
+        { { "e2e4", "d7d5", "e4e5" }, 0x662FAFB965DB29D4ull },
+        { { "e2e4", "d7d5", "e4e5", "f7f5" }, 0x22A48B5A8E47FF78ull },
+        { { "e2e4", "d7d5", "e4e5", "f7f5", "e1e2" }, 0x652A607CA3F242C1ull },
+        { { "e2e4", "d7d5", "e4e5", "f7f5", "e1e2", "e8f7" }, 0x00FDD303C946BDD9ull },
+        { { "a2a4", "b7b5", "h2h4", "b5b4", "c2c4" }, 0x3C8123EA7B067637ull },
+        { { "a2a4", "b7b5", "h2h4", "b5b4", "c2c4", "b4c3", "a1a3" }, 0x5C3F9B829B279560ull },
+    };
+    for (const auto& [moves, expected] : positions) {
+        const auto p = play(start, moves);
+        check(polyglot::key(p.board, p.color) == expected, "polyglot key after " + std::to_string(moves.size()) + " plies");
+    }
+}
+
+SearchTask failingSearch()
+{
+    throw std::runtime_error("search failed");
+    co_return;
+}
+
+SearchTask finishedSearch()
+{
+    co_return;
+}
+
+void schedulerSearchExceptions()
+{
+    // Failing search finishes its job with the error, worker keeps serving other jobs
+    std::atomic<size_t> errors = 0u;
+    std::atomic<size_t> finished = 0u;
+    SearchScheduler scheduler(1u, 1u);
+    scheduler.submit(failingSearch(), 1u, std::nullopt, [&](std::exception_ptr error) {
+        errors += error != nullptr;
+    });
+    scheduler.submit(finishedSearch(), 1u, std::nullopt, [&](std::exception_ptr error) {
+        finished += error == nullptr;
+    });
+    scheduler.wait();
+    check(errors == 1u, "exception is passed to done");
+    check(finished == 1u, "other search finishes");
+}
+
+#ifdef MCE_SEARCH_STATS
+void interleavedSearchCounters()
+{
+    // Two games share one worker, counters of every iteration belong to the game which searched it
+    const std::vector<std::string> fens = {
+        STARTING_FEN,
+        "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    };
+    std::vector<Position> positions;
+    std::vector<BoardStats> stats(fens.size());
+    std::vector<std::unique_ptr<AI>> ais;
+    SearchScheduler scheduler(1u, 500u);
+    for (size_t i = 0u; i < fens.size(); i++) {
+        positions.push_back(parseFen(fens[i]));
+    }
+    for (size_t i = 0u; i < fens.size(); i++) {
+        stats[i].visit(positions[i].board);
+        ais.push_back(std::make_unique<AI>(positions[i].board, positions[i].color, stats[i]));
+        ais[i]->setMaxDepth(6u);
+        scheduler.submit(ais[i]->search(scheduler.sliceNodes()), 1u, std::nullopt, [](std::exception_ptr) {});
+    }
+    scheduler.wait();
+    for (const auto& ai : ais) {
+        size_t nodes = 0u;
+        for (const auto& iteration : ai->iterationStats()) {
+            nodes += iteration.counters.nodes + iteration.counters.qNodes;
+        }
+        check(nodes == ai->nodes(), "iteration counters sum to nodes of their search");
+    }
+}
+#endif
+
+void tablebaseScoresFromRoot()
+{
+    if (tablebaseDir.empty()) {
+        return;
+    }
+    // Children of root are probed one ply away, root score is distance of root itself
+    const auto tablebases = tablebase::Tablebases::load(tablebaseDir);
+    auto p = parseFen("8/8/8/4k3/8/8/8/KQ6 w - - 0 1");
+    const auto result = tablebases->probe(p.board, p.color);
+    check(result && result->wdl == tablebase::Wdl::WIN, "KQK table is loaded");
+    if (!result) {
+        return;
+    }
+    BoardStats stats;
+    stats.visit(p.board);
+    AI ai(p.board, p.color, stats);
+    ai.setTablebases(tablebases.get());
+    ai.setMaxDepth(4u);
+    ai.run();
+    const auto expected = tablebase::WIN_SCORE - static_cast<int>(result->dtm);
+    check(ai.bestScore() == expected, "tablebase win is scored from root, score " + std::to_string(ai.bestScore().value_or(0)));
+}
+
+void sanWithPinnedFigure()
+{
+    // Both knights reach f3, bishop pins the one on d2
+    auto p = parseFen("7k/8/8/4N3/1b6/8/3N4/4K3 w - - 0 1");
+    const auto m = findMove(p.board, p.color, "e5f3");
+    check(m && toSan(p.board, p.color, *m) == "Nf3", "pinned knight needs no disambiguation");
+    const auto found = findSanMove(p.board, p.color, "Nf3");
+    check(found && m && *found == *m, "SAN finds the legal knight move");
+    check(!findSanMove(p.board, p.color, "Ndf3"), "pinned knight move is not found");
+}
+
+void pgnSplitWithCrlf()
+{
+    // Windows line endings, games are still separated by blank line before tags
+    const auto path = std::filesystem::temp_directory_path() / "mce_tests_crlf.pgn";
+    {
+        std::ofstream os(path, std::ios::binary);
+        for (const auto* result : { "1-0", "0-1", "1/2-1/2" }) {
+            os << "[Event \"test\"]\r\n[Result \"" << result << "\"]\r\n\r\n1. e4 e5 2. Nf3 " << result << "\r\n\r\n";
+        }
+    }
+    const auto file = pgn::File::load(path.string());
+    const auto slices = file->split(2u);
+    size_t games = 0u;
+    for (const auto& slice : slices) {
+        pgn::forEachGame(slice, [&games](const pgn::Game&) {
+            games++;
+        });
+    }
+    std::filesystem::remove(path);
+    check(slices.size() == 2u && slices[1].front() == '[', "slice starts at game boundary");
+    check(games == 3u, "every game is read once, read " + std::to_string(games));
+}
+
+#ifndef MCE_SEARCH_STATS
+// Statistics build records every iteration on heap
+void searchWithoutAllocation()
+{
+    auto p = parseFen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    BoardStats stats;
+    stats.visit(p.board);
+    TranspositionTable table(1u);
+    AI ai(p.board, p.color, stats);
+    ai.setTranspositionTable(&table);
+    ai.setMaxDepth(6u);
+    ai.setMultiPv(2u);
+    // First search grows arena of this thread
+    ai.run();
+
+    // Search suspends after every root move, first slice sets it up and searches one root move
+    auto task = ai.search(1u);
+    auto finished = task.resume();
+    const size_t before = allocations;
+    while (!finished) {
+        finished = task.resume();
+    }
+    // Read before check builds its message on heap
+    const size_t after = allocations;
+    check(after == before, "search does not allocate after setup");
+    check(ai.lines().size() == 2u && !ai.lines()[1].pv.empty(), "search finds both lines");
+}
+#endif
+
+void transpositionTableFile()
+{
+    const auto path = (std::filesystem::temp_directory_path() / "mce_tests.tt").string();
+    TranspositionTable table(1u);
+    table.store(0x1234u, 77, 0x0102u, 9u, TranspositionTable::Bound::LOWER);
+    table.save(path);
+
+    TranspositionTable loaded(0u);
+    loaded.load(path);
+    const auto* entry = loaded.probe(0x1234u);
+    check(loaded.sizeMb() == table.sizeMb(), "loaded table has saved size");
+    check(entry && entry->score == 77 && entry->move == 0x0102u && entry->depth == 9u
+            && entry->bound == TranspositionTable::Bound::LOWER,
+        "entry survives save and load");
+
+    // Saving over the mapped file replaces it, loaded table keeps reading its own copy
+    loaded.store(0x5678u, -5, 0u, 3u, TranspositionTable::Bound::EXACT);
+    loaded.save(path);
+    check(loaded.probe(0x1234u) && loaded.probe(0x5678u), "mapped table is readable after save over its file");
+    TranspositionTable reloaded(0u);
+    reloaded.load(path);
+    check(reloaded.probe(0x5678u) != nullptr, "table saved over its own file is loaded back");
+
+    // Format version follows 8 B magic
+    {
+        std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+        fs.seekp(8);
+        const uint32_t version = 0xFFFFu;
+        fs.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    bool rejected = false;
+    try {
+        TranspositionTable other(0u);
+        other.load(path);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    std::filesystem::remove(path);
+    check(rejected, "file with other format version is rejected");
+}
+
+} // namespace
+
+// Optional argument is directory with KQK tablebase
+int main(int argc, char** argv)
+{
+    if (argc > 1) {
+        tablebaseDir = argv[1];
+    }
+    const std::vector<std::pair<std::string, std::function<void()>>> tests = {
+        { "mate scores in transposition table", mateScoresInTranspositionTable },
+        { "polyglot keys", polyglotKeys },
+        { "scheduler search exceptions", schedulerSearchExceptions },
+        { "tablebase scores from root", tablebaseScoresFromRoot },
+        { "SAN with pinned figure", sanWithPinnedFigure },
+        { "PGN split with CRLF", pgnSplitWithCrlf },
+        { "transposition table file", transpositionTableFile },
+#ifdef MCE_SEARCH_STATS
+        { "interleaved search counters", interleavedSearchCounters },
+#else
+        { "search without allocation", searchWithoutAllocation },
+#endif
+    };
+    try {
+        for (const auto& [name, test] : tests) {
+            const auto before = failures;
+            test();
+            std::cout << (failures == before ? "ok     " : "failed ") << name << std::endl;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "FATAL: " << ex.what() << std::endl;
+        return -1;
+    }
+    return failures == 0u ? 0 : -1;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed number of workers with bounded job queue
+// Submitting into full queue blocks, so producer cannot run ahead of workers
+class ThreadPool final {
+public:
+    using Job = std::function<void()>;
+
+    ThreadPool(size_t numThreads, size_t maxQueuedJobs)
+        : _maxQueuedJobs(std::max<size_t>(maxQueuedJobs, 1u))
+    {
+        for (size_t i = 0u; i < std::max<size_t>(numThreads, 1u); i++) {
+            _workers.emplace_back([this] {
+                work();
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _jobAvailable.notify_all();
+        for (auto& w : _workers) {
+            w.join();
+        }
+    }
+
+    void submit(Job job)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _queueFree.wait(lock, [this] {
+            return _jobs.size() < _maxQueuedJobs;
+        });
+        _jobs.push(std::move(job));
+        lock.unlock();
+        _jobAvailable.notify_one();
+    }
+
+    // Blocks until all submitted jobs are finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle.wait(lock, [this] {
+            return _jobs.empty() && _running == 0u;
+        });
+    }
+
+    size_t numThreads() const
+    {
+        return _workers.size();
+    }
+
+private:
+    const size_t _maxQueuedJobs;
+    std::vector<std::thread> _workers;
+    std::queue<Job> _jobs;
+    size_t _running = 0u;
+    bool _quit = false;
+    std::mutex _mutex;
+    std::condition_variable _jobAvailable;
+    std::condition_variable _queueFree;
+    std::condition_variable _idle;
+
+    void work()
+    {
+        while (true) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobAvailable.wait(lock, [this] {
+                return _quit || !_jobs.empty();
+            });
+            if (_jobs.empty()) {
+                // Quit only after queue is drained
+                return;
+            }
+            auto job = std::move(_jobs.front());
+            _jobs.pop();
+            _running++;
+            lock.unlock();
+            _queueFree.notify_one();
+
+            job();
+
+            lock.lock();
+            _running--;
+            if (_jobs.empty() && _running == 0u) {
+                _idle.notify_all();
+            }
+        }
+    }
+};
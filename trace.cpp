@@ -0,0 +1,251 @@
+#include "search_trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr auto DEFAULT_TOP = 10u;
+constexpr size_t NO_NODE = static_cast<size_t>(-1);
+// Upper bounds of cutoff index histogram buckets
+constexpr std::array<size_t, 6u> CUTOFF_BUCKETS = { 0u, 1u, 2u, 3u, 7u, 15u };
+
+constexpr std::array<const char*, 9u> NODE_NAMES = { "pv", "cut", "all", "tt", "tb", "rfp", "razor", "leaf", "end" };
+
+// Records of one search thread in search order with reconstructed tree
+struct Stream {
+    std::vector<TraceRecord> records;
+    std::vector<size_t> parent;
+    // Last searched child, move which caused cutoff of cut node
+    std::vector<size_t> lastChild;
+};
+
+struct PlyStats {
+    size_t nodes = 0u;
+    size_t subtree = 0u;
+    std::array<size_t, NODE_NAMES.size()> types {};
+    size_t cutoffIndexSum = 0u;
+    // Cutoffs by other than first move
+    size_t lateCutoffs = 0u;
+};
+
+struct Hotspot {
+    size_t stream;
+    size_t node;
+    // Nodes spent before cutoff move, or subtree size
+    size_t nodes;
+};
+
+std::map<uint32_t, Stream> load(const std::string& path)
+{
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        throw std::runtime_error("Trace - unable to open " + path);
+    }
+    char magic[8];
+    uint32_t header[2];
+    is.read(magic, sizeof(magic));
+    is.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!is || std::memcmp(magic, "MCETR001", sizeof(magic)) != 0 || header[0] != sizeof(TraceRecord)) {
+        throw std::runtime_error("Trace - invalid file " + path);
+    }
+
+    std::map<uint32_t, Stream> streams;
+    uint32_t chunk[2];
+    while (is.read(reinterpret_cast<char*>(chunk), sizeof(chunk))) {
+        auto& records = streams[chunk[0]].records;
+        const auto offset = records.size();
+        records.resize(offset + chunk[1]);
+        if (!is.read(reinterpret_cast<char*>(records.data() + offset), chunk[1] * sizeof(TraceRecord))) {
+            throw std::runtime_error("Trace - truncated file " + path);
+        }
+    }
+    return streams;
+}
+
+// Records are post-order, children of node are preceding deeper records not claimed yet
+void buildTree(Stream& s)
+{
+    s.parent.assign(s.records.size(), NO_NODE);
+    s.lastChild.assign(s.records.size(), NO_NODE);
+    std::vector<size_t> open;
+    for (size_t i = 0u; i < s.records.size(); i++) {
+        while (!open.empty() && s.records[open.back()].ply > s.records[i].ply) {
+            if (s.lastChild[i] == NO_NODE) {
+                s.lastChild[i] = open.back();
+            }
+            s.parent[open.back()] = i;
+            open.pop_back();
+        }
+        open.push_back(i);
+    }
+}
+
+// Nodes spent on moves searched before the one causing cutoff
+size_t wastedNodes(const Stream& s, size_t node)
+{
+    const auto& r = s.records[node];
+    if (s.lastChild[node] != NO_NODE) {
+        return r.subtree - 1u - s.records[s.lastChild[node]].subtree;
+    }
+    // Children are quiescence only, split subtree evenly among searched moves
+    return r.moves > 0u ? static_cast<size_t>(r.subtree - 1u) * r.cutoffIndex / r.moves : 0u;
+}
+
+std::string moveString(uint16_t move)
+{
+    std::string str;
+    for (const auto sq : { move & 63u, (move >> 6u) & 63u }) {
+        str += static_cast<char>('a' + sq % 8u);
+        str += static_cast<char>('1' + sq / 8u);
+    }
+    return str;
+}
+
+// Moves from root to node
+std::string path(const Stream& s, size_t node)
+{
+    std::vector<uint16_t> moves;
+    for (auto n = node; n != NO_NODE; n = s.parent[n]) {
+        moves.push_back(s.records[n].move);
+    }
+    std::string str;
+    for (auto it = moves.rbegin(); it != moves.rend(); ++it) {
+        str += (str.empty() ? "" : " ") + moveString(*it);
+    }
+    return str;
+}
+
+void printNode(const Stream& s, size_t node)
+{
+    const auto& r = s.records[node];
+    std::cout << "ply " << static_cast<int>(r.ply) << " depth " << static_cast<int>(r.depth) << " " << NODE_NAMES[static_cast<size_t>(r.type)]
+              << " window [" << r.alpha << ", " << r.beta << "] score " << r.score << " subtree " << r.subtree;
+    if (r.cutoffIndex != TraceRecord::NO_CUTOFF) {
+        std::cout << " cutoff " << static_cast<int>(r.cutoffIndex) + 1 << "/" << r.moves;
+    }
+    std::cout << " path " << path(s, node) << std::endl;
+}
+
+void report(std::map<uint32_t, Stream>& streams, size_t top)
+{
+    std::vector<PlyStats> plies;
+    std::array<size_t, CUTOFF_BUCKETS.size() + 1u> cutoffs {};
+    std::vector<Hotspot> hotspots;
+    std::vector<Hotspot> largest;
+    size_t records = 0u;
+
+    for (auto& [thread, s] : streams) {
+        buildTree(s);
+        records += s.records.size();
+        for (size_t i = 0u; i < s.records.size(); i++) {
+            const auto& r = s.records[i];
+            if (plies.size() <= r.ply) {
+                plies.resize(r.ply + 1u);
+            }
+            auto& p = plies[r.ply];
+            p.nodes++;
+            p.subtree += r.subtree;
+            p.types[static_cast<size_t>(r.type)]++;
+            largest.push_back({ thread, i, r.subtree });
+
+            if (r.type != TraceNode::CUT) {
+                continue;
+            }
+            p.cutoffIndexSum += r.cutoffIndex;
+            const auto bucket = std::lower_bound(CUTOFF_BUCKETS.begin(), CUTOFF_BUCKETS.end(), r.cutoffIndex) - CUTOFF_BUCKETS.begin();
+            cutoffs[bucket]++;
+            if (r.cutoffIndex > 0u) {
+                p.lateCutoffs++;
+                hotspots.push_back({ thread, i, wastedNodes(s, i) });
+            }
+        }
+    }
+    std::cout << "Records " << records << " threads " << streams.size() << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "ply   nodes     avg subtree  first cutoff  avg cutoff";
+    for (const auto* name : NODE_NAMES) {
+        std::cout << std::setw(8) << name;
+    }
+    std::cout << std::endl;
+    for (size_t ply = 1u; ply < plies.size(); ply++) {
+        const auto& p = plies[ply];
+        if (p.nodes == 0u) {
+            continue;
+        }
+        const auto cuts = p.types[static_cast<size_t>(TraceNode::CUT)];
+        const auto firstCuts = cuts - p.lateCutoffs;
+        std::cout << std::left << std::setw(6) << ply << std::setw(10) << p.nodes << std::setw(13) << std::fixed << std::setprecision(1)
+                  << static_cast<double>(p.subtree) / p.nodes << std::setw(14)
+                  << (cuts > 0u ? 100.0 * firstCuts / cuts : 0.0) << std::setw(12)
+                  << (cuts > 0u ? static_cast<double>(p.cutoffIndexSum) / cuts : 0.0) << std::right;
+        for (const auto n : p.types) {
+            std::cout << std::setw(8) << n;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << std::endl;
+
+    std::cout << "Cutoff move index:";
+    size_t low = 0u;
+    for (size_t i = 0u; i < cutoffs.size(); i++) {
+        std::cout << " " << low + 1u;
+        if (i == CUTOFF_BUCKETS.size()) {
+            std::cout << "+";
+        } else if (CUTOFF_BUCKETS[i] > low) {
+            std::cout << "-" << CUTOFF_BUCKETS[i] + 1u;
+        }
+        std::cout << ": " << cutoffs[i];
+        low = i < CUTOFF_BUCKETS.size() ? CUTOFF_BUCKETS[i] + 1u : low;
+    }
+    std::cout << std::endl;
+    std::cout << std::endl;
+
+    const auto byNodes = [](const Hotspot& a, const Hotspot& b) {
+        return a.nodes > b.nodes;
+    };
+    const auto printTop = [&](std::vector<Hotspot>& nodes) {
+        const auto n = std::min(top, nodes.size());
+        std::partial_sort(nodes.begin(), nodes.begin() + n, nodes.end(), byNodes);
+        for (size_t i = 0u; i < n; i++) {
+            std::cout << "  ";
+            if (&nodes == &hotspots) {
+                std::cout << "wasted " << nodes[i].nodes << " ";
+            }
+            printNode(streams[nodes[i].stream], nodes[i].node);
+        }
+        std::cout << std::endl;
+    };
+    std::cout << "Ordering failures (cutoff after first move) by nodes spent before cutoff move:" << std::endl;
+    printTop(hotspots);
+    std::cout << "Largest subtrees:" << std::endl;
+    printTop(largest);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // mce_trace <trace> [top]
+    if (argc < 2) {
+        std::cerr << "usage: mce_trace <trace> [top]" << std::endl;
+        return -1;
+    }
+    try {
+        auto streams = load(argv[1]);
+        report(streams, argc > 2 ? std::stoul(argv[2]) : DEFAULT_TOP);
+    } catch (const std::exception& ex) {
+        std::cerr << "FATAL: " << ex.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
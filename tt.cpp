@@ -0,0 +1,185 @@
+#include "tt.hpp"
+#include "zobrist.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = { 'M', 'C', 'E', 'T', 'T', '0', '0', '1' };
+constexpr uint32_t FORMAT_VERSION = 3u;
+constexpr size_t HEADER_SIZE = 64u;
+constexpr size_t ENGINE_VERSION_SIZE = 16u;
+
+// Entries are written as they are in memory, header guards against other layouts
+struct Header {
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t entrySize;
+    char engineVersion[ENGINE_VERSION_SIZE];
+    uint64_t count;
+    uint64_t sizeMb;
+    char reserved[HEADER_SIZE - 8u - 4u - 4u - ENGINE_VERSION_SIZE - 8u - 8u];
+};
+
+static_assert(sizeof(Header) == HEADER_SIZE, "TT header must keep entries cache line aligned");
+
+Header makeHeader(size_t count, size_t sizeMb)
+{
+    Header header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.formatVersion = FORMAT_VERSION;
+    header.entrySize = sizeof(TranspositionTable::Entry);
+    std::strncpy(header.engineVersion, MCE_VERSION, ENGINE_VERSION_SIZE - 1u);
+    header.count = count;
+    header.sizeMb = sizeMb;
+    return header;
+}
+
+// Write may be partial, e.g. above 2 GB per call
+bool writeAll(int fd, const char* data, size_t size)
+{
+    while (size > 0u) {
+        const auto written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+std::atomic<size_t> defaultSizeMb = TranspositionTable::DEFAULT_SIZE_MB;
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+{
+    resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    unmap();
+}
+
+void TranspositionTable::unmap()
+{
+    if (_mapping) {
+        ::munmap(_mapping, _mappingSize);
+        _mapping = nullptr;
+        _mappingSize = 0u;
+    }
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+    // Largest power of two number of entries fitting into size
+    size_t count = 0u;
+    if (megabytes > 0u) {
+        count = 1u;
+        while (count * 2u * sizeof(Entry) <= megabytes << 20u) {
+            count *= 2u;
+        }
+    }
+    unmap();
+    _storage.assign(count, Entry {});
+    _storage.shrink_to_fit();
+    _entries = _storage.data();
+    _count = count;
+    _mask = count > 0u ? count - 1u : 0u;
+    _sizeMb = megabytes;
+}
+
+void TranspositionTable::clear()
+{
+    std::fill(_entries, _entries + _count, Entry {});
+}
+
+void TranspositionTable::save(const std::string& path) const
+{
+    // Truncating path could be mapped by load, so file is replaced by rename and old mapping keeps old inode
+    const auto tmpPath = path + ".tmp";
+    const auto fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("TT - unable to write " + tmpPath);
+    }
+    const auto header = makeHeader(_count, _sizeMb);
+    const auto written = writeAll(fd, reinterpret_cast<const char*>(&header), HEADER_SIZE)
+        && writeAll(fd, reinterpret_cast<const char*>(_entries), _count * sizeof(Entry));
+    if (::close(fd) != 0 || !written || ::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tmpPath.c_str());
+        throw std::runtime_error("TT - unable to write " + path);
+    }
+}
+
+void TranspositionTable::load(const std::string& path)
+{
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("TT - unable to open " + path);
+    }
+    struct stat st;
+    Header header;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_SIZE || ::pread(fd, &header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE)) {
+        ::close(fd);
+        throw std::runtime_error("TT - invalid file " + path);
+    }
+    const auto expected = makeHeader(header.count, header.sizeMb);
+    // Table index is key & mask, entry count has to be power of two
+    if (std::memcmp(&header, &expected, HEADER_SIZE) != 0 || header.count == 0u || (header.count & (header.count - 1u)) != 0u
+        || static_cast<size_t>(st.st_size) != HEADER_SIZE + header.count * sizeof(Entry)) {
+        ::close(fd);
+        throw std::runtime_error("TT - " + path + " was written by other engine version or layout");
+    }
+    // Private mapping, stores of this process never reach file
+    auto* mapping = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("TT - unable to map " + path);
+    }
+    // Probes hit random pages
+    ::madvise(mapping, st.st_size, MADV_RANDOM);
+
+    unmap();
+    _storage.clear();
+    _storage.shrink_to_fit();
+    _mapping = mapping;
+    _mappingSize = static_cast<size_t>(st.st_size);
+    _entries = reinterpret_cast<Entry*>(static_cast<char*>(mapping) + HEADER_SIZE);
+    _count = header.count;
+    _mask = _count - 1u;
+    _sizeMb = header.sizeMb;
+}
+
+uint64_t TranspositionTable::key(const Board& b, Color c)
+{
+    return b.hash() ^ (c == Color::BLACK ? zobrist::SIDE_KEY : 0u);
+}
+
+TranspositionTable& TranspositionTable::threadLocal()
+{
+    thread_local TranspositionTable table(defaultSizeMb);
+    if (table.sizeMb() != defaultSizeMb) {
+        table.resize(defaultSizeMb);
+    }
+    return table;
+}
+
+void TranspositionTable::setDefaultSize(size_t megabytes)
+{
+    defaultSizeMb = megabytes;
+}
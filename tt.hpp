@@ -0,0 +1,110 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Transposition table of negascout, searches of one thread share one table
+// Slot is replaced when position differs or new search is at least as deep
+//
+// Table can be saved and loaded back for long analysis sessions. File is 64 B header
+// (magic, format version, engine version, entry size, entry count, size in MB) followed by raw entries,
+// loaded file is memory mapped copy-on-write, so pages are read only when probed.
+class TranspositionTable {
+public:
+    static constexpr size_t DEFAULT_SIZE_MB = 16u;
+
+    enum class Bound : uint8_t {
+        EXACT,
+        // Score is at least stored one (beta cutoff)
+        LOWER,
+        // Score is at most stored one (no move raised alpha)
+        UPPER
+    };
+
+    struct Entry {
+        uint64_t key = 0u;
+        int32_t score = 0;
+        // Packed best move, zero if none
+        uint16_t move = 0u;
+        uint8_t depth = 0u;
+        Bound bound = Bound::EXACT;
+    };
+
+    // Zero size disables table, every probe misses
+    explicit TranspositionTable(size_t megabytes = DEFAULT_SIZE_MB);
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+    ~TranspositionTable();
+
+    void resize(size_t megabytes);
+    void clear();
+
+    // Writes header and entries straight from memory into temporary file renamed over path, throws on I/O error
+    // Mapping of previously loaded file stays valid, even if it is the same path
+    void save(const std::string& path) const;
+    // Replaces table by saved one, its size is taken from file
+    // Throws if file cannot be mapped or was written by other engine version or table layout
+    void load(const std::string& path);
+
+    const Entry* probe(uint64_t key) const
+    {
+        if (_count == 0u) {
+            return nullptr;
+        }
+        const auto& entry = _entries[key & _mask];
+        return entry.key == key ? &entry : nullptr;
+    }
+
+    void store(uint64_t key, int score, uint16_t move, size_t depth, Bound bound)
+    {
+        if (_count == 0u) {
+            return;
+        }
+        auto& entry = _entries[key & _mask];
+        if (entry.key == key && entry.depth > depth) {
+            return;
+        }
+        // Best move of shallower search is kept if new search has none
+        if (entry.key != key || move != 0u) {
+            entry.move = move;
+        }
+        entry.key = key;
+        entry.score = score;
+        entry.depth = static_cast<uint8_t>(depth);
+        entry.bound = bound;
+    }
+
+    size_t sizeMb() const
+    {
+        return _sizeMb;
+    }
+
+    // Key of position with side to move c
+    static uint64_t key(const Board& b, Color c);
+    // From square in bits 0-5, to square in bits 6-11, a1a1 is never generated so zero means none
+    static uint16_t packMove(const Move& m)
+    {
+        return static_cast<uint16_t>((m.from.y * Board::WIDTH + m.from.x) | ((m.to.y * Board::WIDTH + m.to.x) << 6u));
+    }
+
+    // Table of calling thread, sized by setDefaultSize
+    static TranspositionTable& threadLocal();
+    // Size of thread local tables, they are resized on next threadLocal call
+    static void setDefaultSize(size_t megabytes);
+
+private:
+    // Heap storage or memory mapped file
+    std::vector<Entry> _storage;
+    void* _mapping = nullptr;
+    size_t _mappingSize = 0u;
+    Entry* _entries = nullptr;
+    size_t _count = 0u;
+    size_t _mask = 0u;
+    size_t _sizeMb = 0u;
+
+    void unmap();
+};
@@ -0,0 +1,461 @@
+#include "evaluation.hpp"
+#include "fen.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+// Texel tuning of material and PST values
+//
+// Every position is resolved by quiescence search once while loading, tuned evaluation of its
+// quiet leaf is linear in parameters: sum of material and PST entries of figures (black ones
+// negated) plus fixed terms (pawn structure, king shelter). Mean squared error between game
+// result and sigmoid(K * eval) is minimised by Adam over full gradient, computed in parallel
+// over batches of positions stored as structure of arrays.
+
+namespace {
+
+constexpr size_t NUM_KINDS = 6u;
+// Material of pawn ... queen, king has fixed value
+constexpr size_t NUM_MATERIAL = NUM_KINDS - 1u;
+constexpr size_t NUM_PARAMS = NUM_MATERIAL + NUM_KINDS * 64u;
+constexpr size_t BATCH_SIZE = 16384u;
+constexpr size_t DEFAULT_EPOCHS = 300u;
+constexpr double LEARNING_RATE = 2.0;
+constexpr double ADAM_BETA1 = 0.9;
+constexpr double ADAM_BETA2 = 0.999;
+constexpr double ADAM_EPSILON = 1e-8;
+
+constexpr std::array<const char*, NUM_KINDS> PST_NAMES = { "PAWN_PST", "KNIGHT_PST", "BISHOP_PST", "ROOK_PST", "QUEEN_PST", "KING_PST" };
+constexpr std::array<const char*, NUM_MATERIAL> MATERIAL_NAMES = { "pawn", "knight", "bishop", "rook", "queen" };
+
+using Params = std::vector<double>;
+
+size_t figureKind(Figure f)
+{
+    switch (f) {
+    case Figure::PAWN:
+    case Figure::PAWN_IDLE:
+    case Figure::PAWN_EN_PASSANT:
+        return 0u;
+    case Figure::KNIGHT:
+        return 1u;
+    case Figure::BISHOP:
+        return 2u;
+    case Figure::ROOK:
+    case Figure::ROOK_IDLE:
+        return 3u;
+    case Figure::QUEEN:
+        return 4u;
+    default:
+        return 5u;
+    }
+}
+
+// Representative figure of kind, PST is shared by idle variants
+constexpr std::array<Figure, NUM_KINDS> KIND_FIGURES = { Figure::PAWN, Figure::KNIGHT, Figure::BISHOP, Figure::ROOK, Figure::QUEEN, Figure::KING };
+
+size_t pstParam(size_t kind, int pos)
+{
+    return NUM_MATERIAL + kind * 64u + static_cast<size_t>(pos);
+}
+
+// Current values of figures.cpp
+Params initialParams()
+{
+    Params params(NUM_PARAMS, 0.0);
+    for (size_t kind = 0u; kind < NUM_KINDS; kind++) {
+        const auto f = KIND_FIGURES[kind];
+        if (kind < NUM_MATERIAL) {
+            params[kind] = figureValue(f);
+        }
+        for (int pos = 0; pos < Board::SIZE; pos++) {
+            params[pstParam(kind, pos)] = figureScore(f, Color::WHITE, pos) - figureValue(f);
+        }
+    }
+    return params;
+}
+
+// Positions of one batch, structure of arrays
+// Features of position i are feature/sign[begin[i], begin[i + 1])
+struct Batch {
+    std::vector<uint32_t> begin = { 0u };
+    std::vector<uint16_t> feature;
+    std::vector<int8_t> sign;
+    // Terms not being tuned, from white's point of view
+    std::vector<float> fixed;
+    // 1 white wins, 0.5 draw, 0 black wins
+    std::vector<float> result;
+
+    size_t size() const
+    {
+        return result.size();
+    }
+};
+
+std::optional<float> parseResult(const std::string& line)
+{
+    if (line.find("1/2-1/2") != std::string::npos || line.find("[0.5]") != std::string::npos) {
+        return 0.5f;
+    }
+    if (line.find("1-0") != std::string::npos || line.find("[1.0]") != std::string::npos) {
+        return 1.0f;
+    }
+    if (line.find("0-1") != std::string::npos || line.find("[0.0]") != std::string::npos) {
+        return 0.0f;
+    }
+    return std::nullopt;
+}
+
+// Quiescence search over captures which do not lose material, leaf of principal variation is kept
+int quiesce(Board& b, Color c, int alpha, int beta, Evaluator& evaluator, Board::BoardType& leaf)
+{
+    const auto standPat = evaluator.evaluate(b, c);
+    leaf = b.squares();
+    if (b.kingCaptured() || standPat >= beta) {
+        return standPat;
+    }
+    alpha = std::max(alpha, standPat);
+
+    // Best exchanges first
+    std::vector<std::pair<int, Move>> captures;
+    for (auto generator = b.moveGenerator(c); generator.hasMoves();) {
+        for (const auto& m : generator.movesChunk()) {
+            if (b.isCapture(m)) {
+                const auto see = b.see(m);
+                if (see >= 0) {
+                    captures.emplace_back(see, m);
+                }
+            }
+        }
+    }
+    std::stable_sort(captures.begin(), captures.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    for (const auto& [see, m] : captures) {
+        Board::BoardType childLeaf;
+        const auto undos = b.applyMove(m);
+        const auto score = -quiesce(b, enemyColor(c), -beta, -alpha, evaluator, childLeaf);
+        b.undoMove(undos);
+        if (score > alpha) {
+            alpha = score;
+            leaf = childLeaf;
+        }
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+    return alpha;
+}
+
+// Returns false if position is skipped
+bool addPosition(Batch& batch, const std::string& line, Evaluator& evaluator)
+{
+    const auto result = parseResult(line);
+    if (!result) {
+        return false;
+    }
+    auto position = parseFen(line);
+    auto& board = position.board;
+    if (board.kingCaptured() || board.kingInCheck(enemyColor(position.color))) {
+        return false;
+    }
+
+    Board::BoardType leafSquares;
+    quiesce(board, position.color, -std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), evaluator, leafSquares);
+    const Board leaf(leafSquares);
+    if (leaf.kingCaptured()) {
+        return false;
+    }
+
+    for (int pos = 0; pos < Board::SIZE; pos++) {
+        const auto sq = leaf.get(pos);
+        if (figure(sq) == Figure::NONE) {
+            continue;
+        }
+        const auto kind = figureKind(figure(sq));
+        const int8_t sign = color(sq) == Color::WHITE ? 1 : -1;
+        if (kind < NUM_MATERIAL) {
+            batch.feature.push_back(static_cast<uint16_t>(kind));
+            batch.sign.push_back(sign);
+        }
+        batch.feature.push_back(static_cast<uint16_t>(pstParam(kind, color(sq) == Color::WHITE ? pos : 63 - pos)));
+        batch.sign.push_back(sign);
+    }
+    batch.begin.push_back(static_cast<uint32_t>(batch.feature.size()));
+    batch.fixed.push_back(static_cast<float>(evaluator.evaluate(leaf, Color::WHITE) - leaf.score()));
+    batch.result.push_back(*result);
+    return true;
+}
+
+std::vector<Batch> loadPositions(const std::string& path, ThreadPool& pool)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Tune - unable to open " + path);
+    }
+    std::vector<std::unique_ptr<Batch>> batches;
+    std::atomic<size_t> skipped = 0u;
+    std::vector<std::string> lines;
+
+    const auto flush = [&] {
+        batches.push_back(std::make_unique<Batch>());
+        pool.submit([&batch = *batches.back(), lines = std::move(lines), &skipped] {
+            auto& evaluator = Evaluator::threadLocal();
+            for (const auto& line : lines) {
+                try {
+                    if (!addPosition(batch, line, evaluator)) {
+                        skipped++;
+                    }
+                } catch (const std::exception&) {
+                    skipped++;
+                }
+            }
+        });
+        lines.clear();
+    };
+    for (std::string line; std::getline(file, line);) {
+        lines.push_back(std::move(line));
+        if (lines.size() == BATCH_SIZE) {
+            flush();
+        }
+    }
+    if (!lines.empty()) {
+        flush();
+    }
+    pool.wait();
+
+    std::vector<Batch> result;
+    for (auto& batch : batches) {
+        result.push_back(std::move(*batch));
+    }
+    if (skipped > 0u) {
+        std::cerr << "Tune - skipped " << skipped << " positions" << std::endl;
+    }
+    return result;
+}
+
+// Sum of squared errors of batch, gradient is accumulated if not nullptr
+double batchError(const Batch& batch, const std::vector<float>& params, double k, std::vector<double>* gradient)
+{
+    const auto n = batch.size();
+    std::vector<float> eval(n);
+    for (size_t i = 0u; i < n; i++) {
+        auto sum = batch.fixed[i];
+        for (auto f = batch.begin[i]; f < batch.begin[i + 1u]; f++) {
+            sum += batch.sign[f] * params[batch.feature[f]];
+        }
+        eval[i] = sum;
+    }
+
+    // Sigmoid 1 / (1 + 10^(-k * eval / 400)), loops are kept simple for vectorisation
+    const auto scale = static_cast<float>(-k * std::log(10.0) / 400.0);
+    std::vector<float> sigmoid(n);
+    for (size_t i = 0u; i < n; i++) {
+        sigmoid[i] = 1.0f / (1.0f + std::exp(scale * eval[i]));
+    }
+    double error = 0.0;
+    for (size_t i = 0u; i < n; i++) {
+        const auto diff = batch.result[i] - sigmoid[i];
+        error += diff * diff;
+    }
+    if (!gradient) {
+        return error;
+    }
+
+    // d error / d eval
+    for (size_t i = 0u; i < n; i++) {
+        eval[i] = 2.0f * (sigmoid[i] - batch.result[i]) * sigmoid[i] * (1.0f - sigmoid[i]) * -scale;
+    }
+    for (size_t i = 0u; i < n; i++) {
+        for (auto f = batch.begin[i]; f < batch.begin[i + 1u]; f++) {
+            (*gradient)[batch.feature[f]] += batch.sign[f] * eval[i];
+        }
+    }
+    return error;
+}
+
+class Tuner {
+public:
+    Tuner(std::vector<Batch> batches, ThreadPool& pool)
+        : _batches(std::move(batches))
+        , _pool(pool)
+    {
+        for (const auto& b : _batches) {
+            _positions += b.size();
+        }
+    }
+
+    size_t positions() const
+    {
+        return _positions;
+    }
+
+    // Mean squared error, gradient of mean is stored if not nullptr
+    double error(const Params& params, double k, Params* gradient)
+    {
+        const std::vector<float> values(params.begin(), params.end());
+        std::mutex mutex;
+        double total = 0.0;
+        if (gradient) {
+            gradient->assign(NUM_PARAMS, 0.0);
+        }
+
+        for (const auto& batch : _batches) {
+            _pool.submit([&] {
+                std::vector<double> local(gradient ? NUM_PARAMS : 0u, 0.0);
+                const auto e = batchError(batch, values, k, gradient ? &local : nullptr);
+                std::lock_guard<std::mutex> lock(mutex);
+                total += e;
+                for (size_t i = 0u; i < local.size(); i++) {
+                    (*gradient)[i] += local[i];
+                }
+            });
+        }
+        _pool.wait();
+
+        if (gradient) {
+            for (auto& g : *gradient) {
+                g /= static_cast<double>(_positions);
+            }
+        }
+        return total / static_cast<double>(_positions);
+    }
+
+    // Golden section search of sigmoid scaling, which fits current evaluation best
+    double fitScale(const Params& params)
+    {
+        const auto ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+        double lo = 0.1;
+        double hi = 3.0;
+        for (size_t i = 0u; i < 30u; i++) {
+            const auto a = hi - ratio * (hi - lo);
+            const auto b = lo + ratio * (hi - lo);
+            if (error(params, a, nullptr) < error(params, b, nullptr)) {
+                hi = b;
+            } else {
+                lo = a;
+            }
+        }
+        return (lo + hi) / 2.0;
+    }
+
+    Params tune(Params params, double k, size_t epochs)
+    {
+        Params m(NUM_PARAMS, 0.0);
+        Params v(NUM_PARAMS, 0.0);
+        Params gradient;
+
+        for (size_t epoch = 1u; epoch <= epochs; epoch++) {
+            const auto e = error(params, k, &gradient);
+            const auto correction1 = 1.0 - std::pow(ADAM_BETA1, epoch);
+            const auto correction2 = 1.0 - std::pow(ADAM_BETA2, epoch);
+            for (size_t i = 0u; i < NUM_PARAMS; i++) {
+                m[i] = ADAM_BETA1 * m[i] + (1.0 - ADAM_BETA1) * gradient[i];
+                v[i] = ADAM_BETA2 * v[i] + (1.0 - ADAM_BETA2) * gradient[i] * gradient[i];
+                params[i] -= LEARNING_RATE * (m[i] / correction1) / (std::sqrt(v[i] / correction2) + ADAM_EPSILON);
+            }
+            if (epoch % 10u == 0u || epoch == 1u) {
+                std::cerr << "Epoch " << epoch << ", error " << std::setprecision(8) << e << std::endl;
+            }
+        }
+        return params;
+    }
+
+private:
+    std::vector<Batch> _batches;
+    ThreadPool& _pool;
+    size_t _positions = 0u;
+};
+
+// Same layout as figures.cpp
+void printTables(std::ostream& os, const Params& params)
+{
+    for (size_t kind = 0u; kind < NUM_KINDS; kind++) {
+        os << "const Pst " << PST_NAMES[kind] << " = {\n";
+        for (int y = 0; y < Board::HEIGHT; y++) {
+            os << "   ";
+            for (int x = 0; x < Board::WIDTH; x++) {
+                os << std::setw(5) << std::lround(params[pstParam(kind, y * Board::WIDTH + x)]) << ',';
+            }
+            os << '\n';
+        }
+        os << "};\n\n";
+    }
+
+    os << "const std::array<int, NUM_FIGURES> FIGURE_SCORE = {\n";
+    const auto material = [&](size_t kind, const char* comment) {
+        os << "    " << std::lround(params[kind]) << ", // " << comment << '\n';
+    };
+    material(0u, "pawn");
+    material(0u, "pawn idle");
+    material(0u, "pawn en passant");
+    material(1u, MATERIAL_NAMES[1]);
+    material(2u, MATERIAL_NAMES[2]);
+    material(3u, MATERIAL_NAMES[3]);
+    material(3u, "rook idle");
+    material(4u, MATERIAL_NAMES[4]);
+    os << "    " << figureValue(Figure::KING) << ", // king\n";
+    os << "    " << figureValue(Figure::KING) << " // king idle\n";
+    os << "};\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // mce_tune <positions> [epochs] [threads] [output]
+    if (argc < 2) {
+        std::cerr << "usage: mce_tune <positions> [epochs] [threads] [output]" << std::endl;
+        return -1;
+    }
+    try {
+        using namespace std::chrono;
+        const auto start = steady_clock::now();
+        const auto epochs = argc > 2 ? std::stoul(argv[2]) : DEFAULT_EPOCHS;
+        const auto threads = argc > 3 ? std::stoul(argv[3]) : 0u;
+        const auto numThreads = threads > 0u ? threads : std::max(1u, std::thread::hardware_concurrency());
+        ThreadPool pool(numThreads, numThreads * 2u);
+
+        Tuner tuner(loadPositions(argv[1], pool), pool);
+        if (tuner.positions() == 0u) {
+            throw std::runtime_error("Tune - no positions in " + std::string(argv[1]));
+        }
+        std::cerr << "Loaded " << tuner.positions() << " positions in "
+                  << duration_cast<milliseconds>(steady_clock::now() - start).count() << " ms" << std::endl;
+
+        auto params = initialParams();
+        const auto k = tuner.fitScale(params);
+        std::cerr << "K " << k << ", initial error " << std::setprecision(8) << tuner.error(params, k, nullptr) << std::endl;
+
+        params = tuner.tune(std::move(params), k, epochs);
+        std::cerr << "Final error " << tuner.error(params, k, nullptr) << ", "
+                  << duration_cast<milliseconds>(steady_clock::now() - start).count() << " ms" << std::endl;
+
+        if (argc > 4) {
+            std::ofstream os(argv[4]);
+            if (!os) {
+                throw std::runtime_error("Tune - unable to create " + std::string(argv[4]));
+            }
+            printTables(os, params);
+        } else {
+            printTables(std::cout, params);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "FATAL: " << ex.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
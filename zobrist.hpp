@@ -0,0 +1,60 @@
+#pragma once
+
+#include "figures.hpp"
+
+#include <array>
+#include <cstdint>
+
+// Zobrist keys generated at compile time, empty square has zero key
+namespace zobrist {
+
+namespace detail {
+
+    constexpr uint64_t splitmix64(uint64_t& state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30u)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27u)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31u);
+    }
+
+    // Indexed by square value, figure occupies lower 4 bits and color bit 4
+    using SquareKeys = std::array<std::array<uint64_t, 64u>, 32u>;
+
+    constexpr SquareKeys generateSquareKeys()
+    {
+        SquareKeys keys {};
+        uint64_t state = 0x6D696E6963686573ull;
+        for (size_t sq = 0u; sq < keys.size(); sq++) {
+            for (size_t pos = 0u; pos < 64u; pos++) {
+                const auto key = splitmix64(state);
+                keys[sq][pos] = figure(static_cast<Square>(sq)) == Figure::NONE ? 0u : key;
+            }
+        }
+        return keys;
+    }
+
+    inline constexpr SquareKeys SQUARE_KEYS = generateSquareKeys();
+
+} // namespace detail
+
+// Idle and en passant variants have their own keys, so castling and en passant rights are part of the key
+constexpr uint64_t squareKey(Square sq, int pos)
+{
+    return detail::SQUARE_KEYS[sq][pos];
+}
+
+// Pawn structure key, every pawn variant hashes as plain pawn and other figures are ignored
+constexpr uint64_t pawnKey(Square sq, int pos)
+{
+    const auto f = figure(sq);
+    if (f != Figure::PAWN && f != Figure::PAWN_IDLE && f != Figure::PAWN_EN_PASSANT) {
+        return 0u;
+    }
+    return squareKey(square(Figure::PAWN, color(sq)), pos);
+}
+
+// Board keys do not contain side to move, xor this for black
+constexpr uint64_t SIDE_KEY = 0xF3A1C5E7D2B49608ull;
+
+} // namespace zobrist